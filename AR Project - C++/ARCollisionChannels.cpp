@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARCollisionChannels.h"
+
+#include "Components/PrimitiveComponent.h"
+
+namespace ARCollision
+{
+	//Starts from ignoring everything so only the responses listed for each body generate contacts
+	static void ConfigureObject(UPrimitiveComponent* component, ECollisionChannel objectType)
+	{
+		component->SetCollisionObjectType(objectType);
+		component->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		component->SetCollisionResponseToAllChannels(ECR_Ignore);
+		component->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_WorldDynamic, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_PhysicsBody, ECR_Block);
+		component->SetGenerateOverlapEvents(false);
+	}
+
+	void ConfigureBlock(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, Block);
+		component->SetCollisionResponseToChannel(Block, ECR_Block);
+		component->SetCollisionResponseToChannel(Turret, ECR_Block);
+		component->SetCollisionResponseToChannel(PlayerProjectile, ECR_Block);
+		component->SetCollisionResponseToChannel(EnemyProjectile, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Pawn, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Visibility, ECR_Block);
+	}
+
+	//Turrets ignore enemy projectiles, the tic tacs fire from inside their own mesh
+	void ConfigureTurret(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, Turret);
+		component->SetCollisionResponseToChannel(Block, ECR_Block);
+		component->SetCollisionResponseToChannel(Turret, ECR_Block);
+		component->SetCollisionResponseToChannel(PlayerProjectile, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Pawn, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Visibility, ECR_Block);
+	}
+
+	//The player's projectile is held in front of the camera before the throw, so it ignores the player and line of sight traces
+	void ConfigurePlayerProjectile(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, PlayerProjectile);
+		component->SetCollisionResponseToChannel(Block, ECR_Block);
+		component->SetCollisionResponseToChannel(Turret, ECR_Block);
+		component->SetCollisionResponseToChannel(EnemyProjectile, ECR_Block);
+	}
+
+	void ConfigureEnemyProjectile(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, EnemyProjectile);
+		component->SetCollisionResponseToChannel(Block, ECR_Block);
+		component->SetCollisionResponseToChannel(PlayerProjectile, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Pawn, ECR_Block);
+	}
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+class UPrimitiveComponent;
+
+/*
+ * Object channels used to tell gameplay bodies apart without casting, and the response matrix between them.
+ * The channels are named in the project's collision settings (Config/DefaultEngine.ini, +DefaultChannelResponses),
+ * the values here must match the order the channels were added there.
+ *
+ * Every gameplay body goes through one of the Configure functions so the matrix lives in one place:
+ *
+ *                     Block  Turret  PlayerProj  EnemyProj  Pawn  Visibility
+ *   Block             B      B       B           B          B     B
+ *   Turret            B      B       B           -          B     B
+ *   PlayerProjectile  B      B       -           B          -     -
+ *   EnemyProjectile   B      -       B           -          B     -
+ *
+ * Overlap events are off for all of them since nothing in the game handles overlaps. Hit notifies are left to
+ * the callers, which only enable them on the bodies whose NotifyHit is used.
+ */
+namespace ARCollision
+{
+	//Regular and bomb projectiles thrown by the player
+	constexpr ECollisionChannel PlayerProjectile = ECC_GameTraceChannel1;
+
+	//Destructible blocks of a level tower and the platform
+	constexpr ECollisionChannel Block = ECC_GameTraceChannel2;
+
+	//Projectiles fired by the tic tacs
+	constexpr ECollisionChannel EnemyProjectile = ECC_GameTraceChannel3;
+
+	//The tic tacs themselves
+	constexpr ECollisionChannel Turret = ECC_GameTraceChannel4;
+
+	inline bool IsProjectile(ECollisionChannel channel) { return channel == PlayerProjectile || channel == EnemyProjectile; }
+
+	UE5_AR_API void ConfigureBlock(UPrimitiveComponent* component);
+	UE5_AR_API void ConfigureTurret(UPrimitiveComponent* component);
+	UE5_AR_API void ConfigurePlayerProjectile(UPrimitiveComponent* component);
+	UE5_AR_API void ConfigureEnemyProjectile(UPrimitiveComponent* component);
+}
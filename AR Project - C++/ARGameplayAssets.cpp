@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARGameplayAssets.h"
+
+#include "ARGameplaySettings.h"
+#include "BombProjectile.h"
+#include "TicTac.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+
+FARGameplayAssets* FARGameplayAssets::instance = nullptr;
+
+const FARGameplayAssets& FARGameplayAssets::Get()
+{
+	if(!instance)
+	{
+		instance = new FARGameplayAssets();
+		FCoreDelegates::OnEnginePreExit.AddStatic(&FARGameplayAssets::Shutdown);
+	}
+	return *instance;
+}
+
+//First called from the class default object constructors, so every asset is loaded once while the module starts up
+FARGameplayAssets::FARGameplayAssets()
+{
+	Resolve();
+
+#if WITH_EDITOR
+	//The settings CDO is only edited in the editor, packaged builds resolve once
+	settingChangedHandle = GetMutableDefault<UARGameplaySettings>()->OnSettingChanged().AddLambda([this](UObject*, FPropertyChangedEvent&)
+	{
+		Resolve();
+	});
+#endif
+}
+
+FARGameplayAssets::~FARGameplayAssets()
+{
+#if WITH_EDITOR
+	if(UObjectInitialized())
+	{
+		GetMutableDefault<UARGameplaySettings>()->OnSettingChanged().Remove(settingChangedHandle);
+	}
+#endif
+}
+
+void FARGameplayAssets::Resolve()
+{
+	const UARGameplaySettings* settings = UARGameplaySettings::Get();
+	generatedBlockMesh = settings->generatedBlockMesh.LoadSynchronous();
+	sphereMesh = settings->sphereMesh.LoadSynchronous();
+	ticTacMaterial = settings->ticTacMaterial.LoadSynchronous();
+	bombMaterialLit = settings->bombMaterialLit.LoadSynchronous();
+	bombMaterialUnlit = settings->bombMaterialUnlit.LoadSynchronous();
+}
+
+//While the garbage collector is still up, the referencer unregisters from it here
+void FARGameplayAssets::Shutdown()
+{
+	delete instance;
+	instance = nullptr;
+}
+
+void FARGameplayAssets::AddReferencedObjects(FReferenceCollector& collector)
+{
+	collector.AddReferencedObject(generatedBlockMesh);
+	collector.AddReferencedObject(sphereMesh);
+	collector.AddReferencedObject(ticTacMaterial);
+	collector.AddReferencedObject(bombMaterialLit);
+	collector.AddReferencedObject(bombMaterialUnlit);
+}
+
+//Spawns tic tacs and bombs out of sight and logs the cost per spawn. Run the same loop on a build from before
+//the shared assets to compare, timing the old lookups on their own in a running session only hits loaded assets
+static FAutoConsoleCommandWithWorldAndArgs ARActorConstructionBenchCommand(
+	TEXT("ar.Bench.ActorConstruction"),
+	TEXT("Times spawning tic tacs and bombs out of sight. Usage: ar.Bench.ActorConstruction [spawns, default 200]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if(!world) return;
+		const int32 spawns = FMath::Max(args.Num() > 0 ? FCString::Atoi(*args[0]) : 200, 1);
+
+		FActorSpawnParameters spawnParams;
+		spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		const FTransform hiddenTF(FVector(0.f, 0.f, -100000.f));
+
+		TArray<AActor*> spawned;
+		spawned.Reserve(spawns);
+		UClass* const spawnClasses[] = { ATicTac::StaticClass(), ABombProjectile::StaticClass() };
+		for(UClass* spawnClass : spawnClasses)
+		{
+			const uint64 startCycles = FPlatformTime::Cycles64();
+			for(int32 index = 0; index < spawns; index++)
+			{
+				spawned.Add(world->SpawnActor<AActor>(spawnClass, hiddenTF, spawnParams));
+			}
+			const double spawnMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+			for(AActor* actor : spawned)
+			{
+				if(actor) actor->Destroy();
+			}
+			spawned.Reset();
+			UE_LOG(LogTemp, Display, TEXT("Actor construction: %s %.2f us per spawn over %i spawns"), *spawnClass->GetName(), spawnMs * 1000.0 / spawns, spawns);
+		}
+	}));
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+class UMaterialInterface;
+class UStaticMesh;
+
+/**
+ * The meshes and materials every gameplay actor shares, resolved from UARGameplaySettings on first use and kept
+ * alive until the engine starts to exit. Constructors take the pointers from here instead of running a
+ * ConstructorHelpers::FObjectFinder lookup per construction, and use the shared materials directly since
+ * nothing sets per-instance parameters on them. Editing the settings resolves them again, actors constructed
+ * after the edit pick up the new assets.
+ */
+class UE5_AR_API FARGameplayAssets : public FGCObject
+{
+public:
+	static const FARGameplayAssets& Get();
+
+	UStaticMesh* generatedBlockMesh = nullptr;
+	UStaticMesh* sphereMesh = nullptr;
+	UMaterialInterface* ticTacMaterial = nullptr;
+	UMaterialInterface* bombMaterialLit = nullptr;
+	UMaterialInterface* bombMaterialUnlit = nullptr;
+
+	virtual void AddReferencedObjects(FReferenceCollector& collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FARGameplayAssets"); }
+
+private:
+	FARGameplayAssets();
+	~FARGameplayAssets();
+
+	void Resolve();
+	static void Shutdown();
+
+	//Heap allocated and freed before exit, a function static would outlive the garbage collector it registers with
+	static FARGameplayAssets* instance;
+	FDelegateHandle settingChangedHandle;
+};
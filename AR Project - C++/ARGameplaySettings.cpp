@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARGameplaySettings.h"
+
+#include "LevelLayoutData.h"
+#include "Misc/CommandLine.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+
+UARGameplaySettings::UARGameplaySettings()
+{
+	CategoryName = TEXT("Game");
+	generatedBlockMesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Engine/BasicShapes/Cube.Cube")));
+	sphereMesh = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Engine/BasicShapes/Sphere.Sphere")));
+	ticTacMaterial = TSoftObjectPtr<UMaterialInterface>(FSoftObjectPath(TEXT("/Game/Assets/Materials/Andy_Mat_Default.Andy_Mat_Default")));
+	bombMaterialLit = TSoftObjectPtr<UMaterialInterface>(FSoftObjectPath(TEXT("/Game/Assets/Materials/BombProjectileMat.BombProjectileMat")));
+	bombMaterialUnlit = TSoftObjectPtr<UMaterialInterface>(FSoftObjectPath(TEXT("/Game/Assets/Materials/BombProjectileUnlit.BombProjectileUnlit")));
+
+	for(const TCHAR* levelName : { TEXT("BP_Level0"), TEXT("BP_Level1"), TEXT("BP_Level2") })
+	{
+		bakedLayouts.Add(levelName, TSoftObjectPtr<ULevelLayoutData>(ULevelLayoutData::GetBakedAssetPath(levelName)));
+	}
+}
+
+bool UARGameplaySettings::IsAsyncPhysicsEnabled() const
+{
+	return useAsyncPhysics || FParse::Param(FCommandLine::Get(), TEXT("ARAsyncPhysics"));
+}
+
+void UARGameplaySettings::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	//The CDO is set up when the module loads, before any world creates its physics scene
+	if(HasAnyFlags(RF_ClassDefaultObject) && IsAsyncPhysicsEnabled())
+	{
+		ApplyPhysicsSettings();
+	}
+}
+
+#if WITH_EDITOR
+void UARGameplaySettings::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	if(IsAsyncPhysicsEnabled()) ApplyPhysicsSettings();
+}
+#endif
+
+void UARGameplaySettings::ApplyPhysicsSettings() const
+{
+	UPhysicsSettings* physicsSettings = UPhysicsSettings::Get();
+	if(!physicsSettings) return;
+
+	const int32 maxSteps = FMath::Max(maxPhysicsStepsPerFrame, 1);
+	physicsSettings->bTickPhysicsAsync = true;
+	physicsSettings->AsyncFixedTimeStepSize = asyncFixedStep;
+	physicsSettings->bSubstepping = false;
+	physicsSettings->MaxPhysicsDeltaTime = asyncFixedStep * maxSteps;
+
+	UE_LOG(LogTemp, Log, TEXT("AR gameplay settings: async fixed step physics, step %.4f s, at most %i steps per frame"),
+		asyncFixedStep, maxSteps);
+}
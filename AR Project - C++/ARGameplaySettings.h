@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "ARGameplaySettings.generated.h"
+
+class ULevelLayoutData;
+class UMaterialInterface;
+class UStaticMesh;
+
+/**
+ * Project wide gameplay settings, edited under Project Settings > Game > AR Gameplay and saved to DefaultGame.ini.
+ * With async physics on, the physics options are pushed into UPhysicsSettings before the first physics scene
+ * is created. Otherwise the project's own physics settings are left as they are.
+ */
+UCLASS(config = Game, defaultconfig, meta = (DisplayName = "AR Gameplay"))
+class UE5_AR_API UARGameplaySettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	UARGameplaySettings();
+
+	static const UARGameplaySettings* Get() { return GetDefault<UARGameplaySettings>(); }
+
+	//Async physics also forced on with -ARAsyncPhysics, e.g. for the headless benchmark
+	bool IsAsyncPhysicsEnabled() const;
+
+	virtual void PostInitProperties() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	//Runs physics on its own fixed step, projectile launches and block destruction checks follow the physics steps
+	//instead of the render frame so outcomes do not depend on the device frame rate
+	UPROPERTY(config, EditAnywhere, Category = "Physics")
+	bool useAsyncPhysics = false;
+
+	UPROPERTY(config, EditAnywhere, Category = "Physics", meta = (EditCondition = "useAsyncPhysics", ClampMin = "0.001", UIMin = "0.001"))
+	float asyncFixedStep = 1.f / 60.f;
+
+	//The time budget, physics never simulates more than this many steps per frame and a slow frame
+	//slows the simulation down rather than taking one huge step
+	UPROPERTY(config, EditAnywhere, Category = "Physics", meta = (EditCondition = "useAsyncPhysics", ClampMin = "1", UIMin = "1", UIMax = "16"))
+	int32 maxPhysicsStepsPerFrame = 4;
+
+	//Towers that can stand at once on different planes, they share the budgets of UTowerBudgetManager
+	UPROPERTY(config, EditAnywhere, Category = "Gameplay", meta = (ClampMin = "1", UIMin = "1", UIMax = "8"))
+	int32 maxTowers = 1;
+
+	//Shared gameplay assets, resolved once by FARGameplayAssets instead of looked up in every actor constructor
+
+	//Mesh for every block of a procedural tower (ar.GeneratedTowerBlocks), sized to the generator's 100 unit blocks
+	UPROPERTY(config, EditAnywhere, Category = "Assets")
+	TSoftObjectPtr<UStaticMesh> generatedBlockMesh;
+
+	//Tic tacs and bombs
+	UPROPERTY(config, EditAnywhere, Category = "Assets")
+	TSoftObjectPtr<UStaticMesh> sphereMesh;
+
+	UPROPERTY(config, EditAnywhere, Category = "Assets")
+	TSoftObjectPtr<UMaterialInterface> ticTacMaterial;
+
+	//The bomb is unlit until it is sparked by blowing into the microphone
+	UPROPERTY(config, EditAnywhere, Category = "Assets")
+	TSoftObjectPtr<UMaterialInterface> bombMaterialLit;
+
+	UPROPERTY(config, EditAnywhere, Category = "Assets")
+	TSoftObjectPtr<UMaterialInterface> bombMaterialUnlit;
+
+	//Baked layout for each level blueprint by name, e.g. BP_Level0. Listed here so the cook packages them,
+	//the BakeLevelLayouts commandlet adds the ones it saves
+	UPROPERTY(config, EditAnywhere, Category = "Assets")
+	TMap<FName, TSoftObjectPtr<ULevelLayoutData>> bakedLayouts;
+
+private:
+	void ApplyPhysicsSettings() const;
+};
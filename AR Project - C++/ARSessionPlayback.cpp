@@ -0,0 +1,207 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARSessionPlayback.h"
+
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+bool FARSessionPlayback::LoadFromFile(const FString& path)
+{
+	FString fullPath = path;
+	if(FPaths::IsRelative(fullPath))
+	{
+		fullPath = FPaths::Combine(FPaths::ProjectDir(), path);
+	}
+
+	TArray<FString> lines;
+	if(!FFileHelper::LoadFileToStringArray(lines, *fullPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("AR playback: could not read recording %s"), *fullPath);
+		return false;
+	}
+
+	poses.Reset();
+	planes.Reset();
+	touches.Reset();
+
+	for(int32 index = 0; index < lines.Num(); index++)
+	{
+		if(!ParseLine(lines[index]))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("AR playback: skipping malformed line %i in %s"), index + 1, *fullPath);
+		}
+	}
+
+	//Recordings are expected in time order but sort anyway so the cursors only ever move forward
+	poses.StableSort([](const FARRecordedPose& a, const FARRecordedPose& b) { return a.time < b.time; });
+	touches.StableSort([](const FARRecordedTouch& a, const FARRecordedTouch& b) { return a.time < b.time; });
+
+	playbackTime = 0.f;
+	poseIndex = 0;
+	touchIndex = 0;
+	Advance(0.f);
+
+	UE_LOG(LogTemp, Log, TEXT("AR playback: loaded %i poses, %i planes and %i touches from %s"),
+		poses.Num(), planes.Num(), touches.Num(), *fullPath);
+	return poses.Num() > 0;
+}
+
+bool FARSessionPlayback::ParseLine(const FString& line)
+{
+	const FString trimmed = line.TrimStartAndEnd();
+	if(trimmed.IsEmpty() || trimmed.StartsWith(TEXT("#"))) return true;
+
+	TArray<FString> tokens;
+	trimmed.ParseIntoArrayWS(tokens);
+	auto number = [&tokens](int32 index) { return FCString::Atof(*tokens[index]); };
+
+	if(tokens[0] == TEXT("view") && tokens.Num() >= 4)
+	{
+		fieldOfView = number(1);
+		viewportSize = FVector2D(number(2), number(3));
+		return true;
+	}
+
+	if(tokens[0] == TEXT("pose") && tokens.Num() >= 8)
+	{
+		FARRecordedPose& pose = poses.AddDefaulted_GetRef();
+		pose.time = number(1);
+		pose.location = FVector(number(2), number(3), number(4));
+		pose.rotation = FRotator(number(5), number(6), number(7)).Quaternion();
+		return true;
+	}
+
+	if(tokens[0] == TEXT("plane") && tokens.Num() >= 10)
+	{
+		FARRecordedPlane& plane = planes.AddDefaulted_GetRef();
+		plane.id = FCString::Atoi(*tokens[1]);
+		plane.transform = FTransform(FRotator(number(5), number(6), number(7)), FVector(number(2), number(3), number(4)));
+		plane.extent = FVector2D(number(8), number(9));
+		return true;
+	}
+
+	if(tokens[0] == TEXT("touch") && tokens.Num() >= 6)
+	{
+		static const TCHAR* actionNames[] = { TEXT("Platform"), TEXT("Level"), TEXT("Spawn"), TEXT("SpawnBomb"), TEXT("Move"), TEXT("Launch") };
+
+		int32 actionIndex = INDEX_NONE;
+		for(int32 index = 0; index < UE_ARRAY_COUNT(actionNames); index++)
+		{
+			if(tokens[3].Equals(actionNames[index], ESearchCase::IgnoreCase))
+			{
+				actionIndex = index;
+				break;
+			}
+		}
+		if(actionIndex == INDEX_NONE) return false;
+
+		FARRecordedTouch& touch = touches.AddDefaulted_GetRef();
+		touch.time = number(1);
+		touch.fingerIndex = FCString::Atoi(*tokens[2]);
+		touch.action = static_cast<EARRecordedTouchAction>(actionIndex);
+		touch.screenPos = FVector2D(number(4), number(5));
+		touch.holdTime = tokens.Num() >= 7 ? number(6) : 0.f;
+		return true;
+	}
+
+	return false;
+}
+
+void FARSessionPlayback::Advance(float deltaSeconds)
+{
+	playbackTime += deltaSeconds;
+	if(poses.Num() == 0) return;
+
+	//Move the cursor to the pose segment containing the playback time
+	while(poseIndex + 1 < poses.Num() && poses[poseIndex + 1].time <= playbackTime)
+	{
+		poseIndex++;
+	}
+
+	const FARRecordedPose& from = poses[poseIndex];
+	if(poseIndex + 1 >= poses.Num() || playbackTime <= from.time)
+	{
+		cameraTransform = FTransform(from.rotation, from.location);
+		return;
+	}
+
+	//Interpolate between the two recorded poses either side of the playback time
+	const FARRecordedPose& to = poses[poseIndex + 1];
+	const float alpha = FMath::Clamp((playbackTime - from.time) / FMath::Max(to.time - from.time, KINDA_SMALL_NUMBER), 0.f, 1.f);
+	cameraTransform = FTransform(FQuat::Slerp(from.rotation, to.rotation, alpha), FMath::Lerp(from.location, to.location, alpha));
+}
+
+bool FARSessionPlayback::PopTouch(FARRecordedTouch& outTouch)
+{
+	if(touchIndex >= touches.Num() || touches[touchIndex].time > playbackTime) return false;
+
+	outTouch = touches[touchIndex++];
+	return true;
+}
+
+bool FARSessionPlayback::DeprojectScreenToWorld(const FVector2D& screenPos, FVector& outWorldPos, FVector& outWorldDir) const
+{
+	if(viewportSize.X <= 0.f || viewportSize.Y <= 0.f) return false;
+
+	//Convert to normalised device coordinates, screen space Y points down
+	const float ndcX = 2.f * screenPos.X / viewportSize.X - 1.f;
+	const float ndcY = 1.f - 2.f * screenPos.Y / viewportSize.Y;
+	const float tanHalfFov = FMath::Tan(FMath::DegreesToRadians(fieldOfView * 0.5f));
+	const float aspect = viewportSize.Y / viewportSize.X;
+
+	const FQuat rotation = cameraTransform.GetRotation();
+	const FVector direction = rotation.GetForwardVector()
+		+ rotation.GetRightVector() * (ndcX * tanHalfFov)
+		+ rotation.GetUpVector() * (ndcY * tanHalfFov * aspect);
+
+	outWorldPos = cameraTransform.GetLocation();
+	outWorldDir = direction.GetSafeNormal();
+	return true;
+}
+
+bool FARSessionPlayback::LineTracePlanes(const FVector2D& screenPos, FTransform& outHitTransform) const
+{
+	FVector origin, direction;
+	if(!DeprojectScreenToWorld(screenPos, origin, direction)) return false;
+
+	return LineTracePlanes(origin, direction, outHitTransform);
+}
+
+bool FARSessionPlayback::LineTracePlanes(const FVector& origin, const FVector& direction, FTransform& outHitTransform) const
+{
+	float closestDistance = TNumericLimits<float>::Max();
+	for(const FARRecordedPlane& plane : planes)
+	{
+		const FVector normal = plane.transform.GetRotation().GetUpVector();
+		const float denominator = FVector::DotProduct(direction, normal);
+		if(FMath::IsNearlyZero(denominator)) continue;
+
+		const float distance = FVector::DotProduct(plane.transform.GetLocation() - origin, normal) / denominator;
+		if(distance <= 0.f || distance >= closestDistance) continue;
+
+		//Only accept hits within the detected extent of the plane
+		const FVector hitPoint = origin + direction * distance;
+		const FVector localHit = plane.transform.InverseTransformPositionNoScale(hitPoint);
+		if(FMath::Abs(localHit.X) > plane.extent.X || FMath::Abs(localHit.Y) > plane.extent.Y) continue;
+
+		closestDistance = distance;
+		outHitTransform = FTransform(plane.transform.GetRotation(), hitPoint);
+	}
+
+	return closestDistance < TNumericLimits<float>::Max();
+}
+
+bool FARSessionPlayback::IsFinished() const
+{
+	const bool posesDone = poses.Num() == 0 || playbackTime >= poses.Last().time;
+	return posesDone && touchIndex >= touches.Num();
+}
+
+FString FARSessionPlayback::GetCommandLinePath()
+{
+	FString path;
+	FParse::Value(FCommandLine::Get(), TEXT("ARPlayback="), path);
+	return path;
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+//The touch actions a recording can replay, these map directly onto the game mode entry points
+enum class EARRecordedTouchAction : uint8
+{
+	Platform,
+	Level,
+	Spawn,
+	SpawnBomb,
+	Move,
+	Launch
+};
+
+struct FARRecordedPose
+{
+	float time = 0.f;
+	FVector location = FVector::ZeroVector;
+	FQuat rotation = FQuat::Identity;
+};
+
+struct FARRecordedPlane
+{
+	int32 id = INDEX_NONE;
+	FTransform transform;
+	FVector2D extent = FVector2D::ZeroVector;
+};
+
+struct FARRecordedTouch
+{
+	float time = 0.f;
+	int32 fingerIndex = 0;
+	EARRecordedTouchAction action = EARRecordedTouchAction::Move;
+	FVector2D screenPos = FVector2D::ZeroVector;
+	float holdTime = 0.f;
+};
+
+/**
+ * Mock AR backend which replays a recorded session (camera poses, detected planes and touches) from a text file.
+ * Lets the spawn level, throw and destroy loop run without an AR device, e.g. under -nullrhi.
+ *
+ * File format, one entry per line ('#' starts a comment):
+ *   view  <fovDegrees> <viewportWidth> <viewportHeight>
+ *   pose  <time> <x> <y> <z> <pitch> <yaw> <roll>
+ *   plane <id> <x> <y> <z> <pitch> <yaw> <roll> <extentX> <extentY>
+ *   touch <time> <finger> <Platform|Level|Spawn|SpawnBomb|Move|Launch> <screenX> <screenY> [holdTime]
+ */
+class UE5_AR_API FARSessionPlayback
+{
+public:
+	bool LoadFromFile(const FString& path);
+
+	//Moves the playback clock forward and updates the interpolated camera pose
+	void Advance(float deltaSeconds);
+
+	//Pops the next touch that is due at the current playback time
+	bool PopTouch(FARRecordedTouch& outTouch);
+
+	bool DeprojectScreenToWorld(const FVector2D& screenPos, FVector& outWorldPos, FVector& outWorldDir) const;
+	bool LineTracePlanes(const FVector2D& screenPos, FTransform& outHitTransform) const;
+	bool LineTracePlanes(const FVector& origin, const FVector& direction, FTransform& outHitTransform) const;
+
+	bool IsFinished() const;
+	float GetPlaybackTime() const { return playbackTime; }
+	const FTransform& GetCameraTransform() const { return cameraTransform; }
+	float GetFieldOfView() const { return fieldOfView; }
+	const FVector2D& GetViewportSize() const { return viewportSize; }
+	FRotator GetDeviceRotation() const { return cameraTransform.Rotator(); }
+
+	//Returns the recording path passed with -ARPlayback=<file>, empty when playback is not requested
+	static FString GetCommandLinePath();
+
+private:
+	bool ParseLine(const FString& line);
+
+	TArray<FARRecordedPose> poses;
+	TArray<FARRecordedPlane> planes;
+	TArray<FARRecordedTouch> touches;
+
+	FTransform cameraTransform;
+	float playbackTime = 0.f;
+	float fieldOfView = 60.f;
+	FVector2D viewportSize = FVector2D(1080.f, 2340.f);
+	int32 poseIndex = 0;
+	int32 touchIndex = 0;
+};
@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARStats.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DelayedAutoRegister.h"
+
+DEFINE_STAT(STAT_AR_VoiceCaptureTick);
+DEFINE_STAT(STAT_AR_ApplyExplosiveForce);
+DEFINE_STAT(STAT_AR_LevelTick);
+DEFINE_STAT(STAT_AR_DecrementHealth);
+DEFINE_STAT(STAT_AR_ItemDrop);
+DEFINE_STAT(STAT_AR_TicTacTick);
+DEFINE_STAT(STAT_AR_HasLineOfSight);
+DEFINE_STAT(STAT_AR_MoveProjectile);
+DEFINE_STAT(STAT_AR_LaunchProjectile);
+DEFINE_STAT(STAT_AR_SupportUpdate);
+DEFINE_STAT(STAT_AR_ProjectileNotifyHit);
+DEFINE_STAT(STAT_AR_ContactDamageApply);
+DEFINE_STAT(STAT_AR_Deproject);
+DEFINE_STAT(STAT_AR_TrajectoryPreview);
+DEFINE_STAT(STAT_AR_GameplayEventFlush);
+DEFINE_STAT(STAT_AR_Blocks);
+DEFINE_STAT(STAT_AR_ActiveBlocks);
+DEFINE_STAT(STAT_AR_BlocksReleased);
+DEFINE_STAT(STAT_AR_HitEvents);
+DEFINE_STAT(STAT_AR_ContactPairs);
+DEFINE_STAT(STAT_AR_ContactDamageEvents);
+DEFINE_STAT(STAT_AR_ContactEventsDropped);
+DEFINE_STAT(STAT_AR_Deprojections);
+DEFINE_STAT(STAT_AR_GameplayEvents);
+DEFINE_STAT(STAT_AR_GameplayEventsCoalesced);
+DEFINE_STAT(STAT_AR_Towers);
+
+CSV_DEFINE_CATEGORY_MODULE(UE5_AR_API, ARGame, true);
+UE_TRACE_CHANNEL_DEFINE(ARGameChannel);
+
+static FAutoConsoleCommand ARDumpStatsCommand(
+	TEXT("ar.DumpStats"),
+	TEXT("Dumps the per-function totals of the gameplay scoped stats. Usage: ar.DumpStats [frames, default 60]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+	{
+		const int32 numFrames = args.Num() > 0 ? FCString::Atoi(*args[0]) : 60;
+		FARFrameStats::Get().Dump(numFrames);
+	}));
+
+static TAutoConsoleVariable<float> CVarHitchThresholdMs(
+	TEXT("ar.HitchThresholdMs"), 50.f,
+	TEXT("Frames longer than this are logged as hitches along with the scoped stats that ran in them, 0 turns the detector off."));
+
+static FAutoConsoleCommand ARCheckAllocationsCommand(
+	TEXT("ar.CheckAllocations"),
+	TEXT("Counts game thread heap allocations inside the gameplay scoped stats and logs an error for every scope that allocates after warm up. Usage: ar.CheckAllocations [frames, default 300] [warmup frames, default 60]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+	{
+		const int32 numFrames = args.Num() > 0 ? FCString::Atoi(*args[0]) : 300;
+		const int32 warmupFrames = args.Num() > 1 ? FCString::Atoi(*args[1]) : 60;
+		if(!FARAllocationCounter::IsInstalled())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Allocation check: needs the counting allocator, relaunch with -ARCountAllocations"));
+			return;
+		}
+		FARFrameStats::Get().BeginAllocationCheck(numFrames, warmupFrames);
+	}));
+
+#if !UE_BUILD_SHIPPING
+namespace
+{
+	uint64 GameThreadAllocations = 0;
+	bool CountingAllocations = false;
+	FMalloc* CountingMalloc = nullptr;
+
+	//Forwards everything to the allocator it wraps, Malloc and growing Realloc on the game thread are counted
+	class FARCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FARCountingMalloc(FMalloc* inInner) : inner(inInner) {}
+
+		virtual void* Malloc(SIZE_T count, uint32 alignment) override { Count(); return inner->Malloc(count, alignment); }
+		virtual void* TryMalloc(SIZE_T count, uint32 alignment) override { Count(); return inner->TryMalloc(count, alignment); }
+		virtual void* Realloc(void* original, SIZE_T count, uint32 alignment) override
+		{
+			//Shrinking stays in place, only a new block or one that outgrows the old size counts
+			SIZE_T originalSize = 0;
+			if(count > 0 && CountingAllocations && IsInGameThread()
+				&& (!original || !inner->GetAllocationSize(original, originalSize) || count > originalSize))
+			{
+				Count();
+			}
+			return inner->Realloc(original, count, alignment);
+		}
+		virtual void Free(void* original) override { inner->Free(original); }
+		virtual SIZE_T QuantizeSize(SIZE_T count, uint32 alignment) override { return inner->QuantizeSize(count, alignment); }
+		virtual bool GetAllocationSize(void* original, SIZE_T& sizeOut) override { return inner->GetAllocationSize(original, sizeOut); }
+		virtual void Trim(bool trimThreadCaches) override { inner->Trim(trimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void InitializeStatsMetadata() override { inner->InitializeStatsMetadata(); }
+		virtual void UpdateStats() override { inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& outStats) override { inner->GetAllocatorStats(outStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& ar) override { inner->DumpAllocatorStats(ar); }
+		virtual bool IsInternallyThreadSafe() const override { return inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return inner->GetDescriptiveName(); }
+
+	private:
+		void Count()
+		{
+			if(CountingAllocations && IsInGameThread()) GameThreadAllocations++;
+		}
+
+		FMalloc* inner;
+	};
+}
+
+//Wraps the allocator at the start of engine pre init, before the other threads are allocating, and is never removed
+static FDelayedAutoRegisterHelper ARCountingMallocRegistration(EDelayedRegisterRunPhase::StartOfEnginePreInit, []
+{
+	if(!CountingMalloc && FParse::Param(FCommandLine::Get(), TEXT("ARCountAllocations")))
+	{
+		CountingMalloc = new FARCountingMalloc(GMalloc);
+		GMalloc = CountingMalloc;
+	}
+});
+
+bool FARAllocationCounter::IsInstalled()
+{
+	return CountingMalloc != nullptr;
+}
+
+void FARAllocationCounter::SetCounting(bool counting)
+{
+	CountingAllocations = counting;
+}
+
+uint64 FARAllocationCounter::GetGameThreadAllocations()
+{
+	return GameThreadAllocations;
+}
+#else
+bool FARAllocationCounter::IsInstalled() { return false; }
+void FARAllocationCounter::SetCounting(bool counting) {}
+uint64 FARAllocationCounter::GetGameThreadAllocations() { return 0; }
+#endif
+
+FARFrameStats& FARFrameStats::Get()
+{
+	static FARFrameStats instance;
+	return instance;
+}
+
+FARFrameStats::FARFrameStats()
+{
+	history.SetNum(historySize);
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FARFrameStats::EndFrame);
+}
+
+const TCHAR* FARFrameStats::GetStatName(EARStat stat)
+{
+	static const TCHAR* names[statCount] =
+	{
+		TEXT("VoiceCaptureTick"),
+		TEXT("ApplyExplosiveForce"),
+		TEXT("LevelTick"),
+		TEXT("DecrementHealth"),
+		TEXT("ItemDrop"),
+		TEXT("TicTacTick"),
+		TEXT("HasLineOfSight"),
+		TEXT("MoveProjectile"),
+		TEXT("LaunchProjectile"),
+		TEXT("SupportUpdate"),
+		TEXT("ProjectileNotifyHit"),
+		TEXT("ContactDamageApply"),
+		TEXT("Deproject"),
+		TEXT("TrajectoryPreview"),
+		TEXT("GameplayEventFlush")
+	};
+	return names[static_cast<int32>(stat)];
+}
+
+void FARFrameStats::Add(EARStat stat, uint64 cycles, uint32 allocations)
+{
+	//The instrumented paths are all game thread, ignore anything else rather than locking
+	if(!IsInGameThread()) return;
+	
+	const int32 index = static_cast<int32>(stat);
+	current.cycles[index] += cycles;
+	current.calls[index]++;
+	current.allocations[index] += allocations;
+	runningCycles[index] += cycles;
+	runningCalls[index]++;
+}
+
+void FARFrameStats::EndFrame()
+{
+	DetectHitch();
+	
+	history[head] = current;
+	head = (head + 1) % historySize;
+	recordedFrames = FMath::Min(recordedFrames + 1, historySize);
+	current = FFrame();
+
+	if(allocationWarmupFrames > 0)
+	{
+		allocationWarmupFrames--;
+	}
+	else if(allocationCheckFrames > 0 && --allocationCheckFrames == 0)
+	{
+		FARAllocationCounter::SetCounting(false);
+		ReportAllocationCheck();
+	}
+}
+
+void FARFrameStats::BeginHitchReport(double windowSeconds)
+{
+	reportEndTime = FPlatformTime::Seconds() + windowSeconds;
+	reportHitchCount = 0;
+	worstHitchMs = 0.0;
+
+	//The frame the report starts in carries the load and prewarm, it is not measured
+	lastFrameEndTime = 0.0;
+}
+
+//Runs before the frame goes into the history, so current still holds the scopes of the long frame
+void FARFrameStats::DetectHitch()
+{
+	const double now = FPlatformTime::Seconds();
+	const double frameMs = lastFrameEndTime > 0.0 ? (now - lastFrameEndTime) * 1000.0 : 0.0;
+	lastFrameEndTime = now;
+
+	const float thresholdMs = CVarHitchThresholdMs.GetValueOnGameThread();
+	if(thresholdMs > 0.f && frameMs > thresholdMs)
+	{
+		hitchCount++;
+		reportHitchCount++;
+		worstHitchMs = FMath::Max(worstHitchMs, frameMs);
+
+		//The three most expensive scopes are usually enough to name the cause
+		int32 top[3] = { INDEX_NONE, INDEX_NONE, INDEX_NONE };
+		for(int32 stat = 0; stat < statCount; stat++)
+		{
+			if(current.calls[stat] == 0) continue;
+			for(int32 slot = 0; slot < UE_ARRAY_COUNT(top); slot++)
+			{
+				if(top[slot] == INDEX_NONE || current.cycles[stat] > current.cycles[top[slot]])
+				{
+					for(int32 move = UE_ARRAY_COUNT(top) - 1; move > slot; move--) top[move] = top[move - 1];
+					top[slot] = stat;
+					break;
+				}
+			}
+		}
+
+		FString scopes;
+		for(int32 stat : top)
+		{
+			if(stat == INDEX_NONE) break;
+			scopes += FString::Printf(TEXT(" %s %.2f ms (%u calls),"), GetStatName(static_cast<EARStat>(stat)),
+				FPlatformTime::ToMilliseconds64(current.cycles[stat]), current.calls[stat]);
+		}
+		scopes.RemoveFromEnd(TEXT(","));
+		UE_LOG(LogTemp, Warning, TEXT("Hitch: frame %llu took %.2f ms, scoped stats:%s"), GFrameCounter, frameMs,
+			scopes.IsEmpty() ? TEXT(" none, the time went outside the gameplay scopes") : *scopes);
+	}
+
+	if(reportEndTime > 0.0 && now >= reportEndTime)
+	{
+		reportEndTime = 0.0;
+		UE_LOG(LogTemp, Display, TEXT("Hitch report: %u frames over %.1f ms since start play, worst %.2f ms"),
+			reportHitchCount, thresholdMs, worstHitchMs);
+	}
+}
+
+void FARFrameStats::BeginAllocationCheck(int32 numFrames, int32 warmupFrames)
+{
+	FARAllocationCounter::SetCounting(true);
+	allocationCheckLength = FMath::Clamp(numFrames, 1, historySize);
+	allocationCheckFrames = allocationCheckLength;
+	allocationWarmupFrames = FMath::Max(warmupFrames, 0);
+}
+
+//Warm up lets the kept scratch arrays and pools reach their working size, after that a scope should never allocate
+void FARFrameStats::ReportAllocationCheck() const
+{
+	uint32 failedScopes = 0;
+	for(int32 stat = 0; stat < statCount; stat++)
+	{
+		uint32 allocations = 0;
+		uint32 calls = 0;
+		for(int32 frame = 0; frame < allocationCheckLength; frame++)
+		{
+			const FFrame& entry = history[(head - 1 - frame + historySize) % historySize];
+			allocations += entry.allocations[stat];
+			calls += entry.calls[stat];
+		}
+
+		if(allocations > 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Allocation check: %s made %u heap allocations over %u calls in %i frames"),
+				GetStatName(static_cast<EARStat>(stat)), allocations, calls, allocationCheckLength);
+			failedScopes++;
+		}
+	}
+
+	if(failedScopes == 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Allocation check: passed, no gameplay scope allocated in %i frames"), allocationCheckLength);
+	}
+}
+
+void FARFrameStats::Dump(int32 numFrames) const
+{
+	if(recordedFrames == 0) return;
+	numFrames = FMath::Clamp(numFrames, 1, recordedFrames);
+
+	UE_LOG(LogTemp, Display, TEXT("ARGame stats over the last %i frames:"), numFrames);
+	UE_LOG(LogTemp, Display, TEXT("%-22s %10s %10s %10s %8s %8s"), TEXT("Function"), TEXT("Total ms"), TEXT("Avg ms"), TEXT("Max ms"), TEXT("Calls"), TEXT("Allocs"));
+	
+	for(int32 stat = 0; stat < statCount; stat++)
+	{
+		uint64 totalCycles = 0;
+		uint64 maxCycles = 0;
+		uint32 totalCalls = 0;
+		uint32 totalAllocations = 0;
+		
+		for(int32 frame = 0; frame < numFrames; frame++)
+		{
+			const FFrame& entry = history[(head - 1 - frame + historySize) % historySize];
+			totalCycles += entry.cycles[stat];
+			maxCycles = FMath::Max(maxCycles, entry.cycles[stat]);
+			totalCalls += entry.calls[stat];
+			totalAllocations += entry.allocations[stat];
+		}
+
+		const double totalMs = FPlatformTime::ToMilliseconds64(totalCycles);
+		UE_LOG(LogTemp, Display, TEXT("%-22s %10.3f %10.4f %10.4f %8u %8u"), GetStatName(static_cast<EARStat>(stat)),
+			totalMs, totalMs / numFrames, FPlatformTime::ToMilliseconds64(maxCycles), totalCalls, totalAllocations);
+	}
+}
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+/*
+ * Instrumentation for the gameplay hot paths. AR_SCOPED_STAT(Name) feeds the same scope to:
+ *  - the ARGame stat group (stat ARGame)
+ *  - the ARGame CSV profiler category (csvprofile start/stop on device)
+ *  - the ARGameChannel trace channel in Unreal Insights (-trace=cpu,ARGameChannel)
+ *  - FARFrameStats, which keeps per-frame totals for ar.DumpStats <frames>
+ *
+ * ar.CheckAllocations counts the game thread heap allocations made inside each scope and reports any scope that
+ * still allocates once gameplay has warmed up. It needs -ARCountAllocations on the command line, which wraps the
+ * allocator at startup. Hot paths use FMemStack marks or kept scratch arrays instead.
+ */
+
+DECLARE_STATS_GROUP(TEXT("ARGame"), STATGROUP_ARGame, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bomb Voice Capture Tick"), STAT_AR_VoiceCaptureTick, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bomb Apply Explosive Force"), STAT_AR_ApplyExplosiveForce, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Level Tick"), STAT_AR_LevelTick, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Level Decrement Health"), STAT_AR_DecrementHealth, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Level Item Drop"), STAT_AR_ItemDrop, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tic Tac Tick"), STAT_AR_TicTacTick, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tic Tac Line Of Sight"), STAT_AR_HasLineOfSight, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Game Mode Move Projectile"), STAT_AR_MoveProjectile, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Game Mode Launch Projectile"), STAT_AR_LaunchProjectile, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Level Support Update"), STAT_AR_SupportUpdate, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Notify Hit"), STAT_AR_ProjectileNotifyHit, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Contact Damage Apply"), STAT_AR_ContactDamageApply, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Screen Deproject"), STAT_AR_Deproject, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Trajectory Preview"), STAT_AR_TrajectoryPreview, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gameplay Event Flush"), STAT_AR_GameplayEventFlush, STATGROUP_ARGame, UE5_AR_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Blocks"), STAT_AR_Blocks, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Active Blocks"), STAT_AR_ActiveBlocks, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Blocks Released"), STAT_AR_BlocksReleased, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hit Events"), STAT_AR_HitEvents, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Contact Pairs Filtered"), STAT_AR_ContactPairs, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Contact Damage Events"), STAT_AR_ContactDamageEvents, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Contact Damage Events Dropped"), STAT_AR_ContactEventsDropped, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Screen Deprojections"), STAT_AR_Deprojections, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gameplay Events"), STAT_AR_GameplayEvents, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gameplay Events Coalesced"), STAT_AR_GameplayEventsCoalesced, STATGROUP_ARGame, UE5_AR_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Towers"), STAT_AR_Towers, STATGROUP_ARGame, UE5_AR_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(UE5_AR_API, ARGame);
+UE_TRACE_CHANNEL_EXTERN(ARGameChannel, UE5_AR_API);
+
+//One entry per scoped stat, the names match the AR_SCOPED_STAT arguments
+enum class EARStat : uint8
+{
+	VoiceCaptureTick,
+	ApplyExplosiveForce,
+	LevelTick,
+	DecrementHealth,
+	ItemDrop,
+	TicTacTick,
+	HasLineOfSight,
+	MoveProjectile,
+	LaunchProjectile,
+	SupportUpdate,
+	ProjectileNotifyHit,
+	ContactDamageApply,
+	Deproject,
+	TrajectoryPreview,
+	GameplayEventFlush,
+	Count
+};
+
+//Game thread heap allocations seen since the counting allocator was installed, always zero before that
+struct UE5_AR_API FARAllocationCounter
+{
+	static bool IsInstalled();
+	static void SetCounting(bool counting);
+	static uint64 GetGameThreadAllocations();
+};
+
+/**
+ * Game thread per-frame totals of the scoped stats, kept in a ring of recent frames so they can be
+ * dumped without a stats capture running.
+ */
+class UE5_AR_API FARFrameStats
+{
+public:
+	static constexpr int32 historySize = 600;
+	static constexpr int32 statCount = static_cast<int32>(EARStat::Count);
+
+	struct FFrame
+	{
+		uint64 cycles[statCount] = {};
+		uint32 calls[statCount] = {};
+		uint32 allocations[statCount] = {};
+	};
+
+	static FARFrameStats& Get();
+	static const TCHAR* GetStatName(EARStat stat);
+
+	void Add(EARStat stat, uint64 cycles, uint32 allocations);
+	void Dump(int32 numFrames) const;
+
+	//Counts allocations for warmupFrames, then fails any scope that allocates during the following numFrames
+	void BeginAllocationCheck(int32 numFrames, int32 warmupFrames);
+
+	//Counts hitches from the next frame on and logs the total once windowSeconds have passed, StartPlay opens a 60 second window
+	void BeginHitchReport(double windowSeconds);
+	uint32 GetHitchCount() const { return hitchCount; }
+
+	//Running totals since startup, callers diff two reads to measure a window longer than the history
+	double GetTotalMs(EARStat stat) const { return FPlatformTime::ToMilliseconds64(runningCycles[static_cast<int32>(stat)]); }
+	uint64 GetTotalCalls(EARStat stat) const { return runningCalls[static_cast<int32>(stat)]; }
+
+private:
+	FARFrameStats();
+	void EndFrame();
+	void ReportAllocationCheck() const;
+	void DetectHitch();
+
+	TArray<FFrame> history;
+	FFrame current;
+	uint64 runningCycles[statCount] = {};
+	uint64 runningCalls[statCount] = {};
+	int32 head = 0;
+	int32 recordedFrames = 0;
+	int32 allocationWarmupFrames = 0;
+	int32 allocationCheckFrames = 0;
+	int32 allocationCheckLength = 0;
+
+	//Wall time of the previous EndFrame, a frame longer than ar.HitchThresholdMs is logged with its scoped stats
+	double lastFrameEndTime = 0.0;
+	uint32 hitchCount = 0;
+	uint32 reportHitchCount = 0;
+	double reportEndTime = 0.0;
+	double worstHitchMs = 0.0;
+};
+
+struct FARScopedFrameStat
+{
+	explicit FARScopedFrameStat(EARStat inStat) : stat(inStat), startCycles(FPlatformTime::Cycles64()), startAllocations(FARAllocationCounter::GetGameThreadAllocations()) {}
+	~FARScopedFrameStat()
+	{
+		FARFrameStats::Get().Add(stat, FPlatformTime::Cycles64() - startCycles, static_cast<uint32>(FARAllocationCounter::GetGameThreadAllocations() - startAllocations));
+	}
+
+	EARStat stat;
+	uint64 startCycles;
+	uint64 startAllocations;
+};
+
+#if UE_BUILD_SHIPPING
+#define AR_SCOPED_STAT(Name) \
+	CSV_SCOPED_TIMING_STAT(ARGame, Name)
+#else
+#define AR_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_AR_##Name); \
+	CSV_SCOPED_TIMING_STAT(ARGame, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, ARGameChannel); \
+	FARScopedFrameStat PREPROCESSOR_JOIN(arFrameStat, __LINE__)(EARStat::Name)
+#endif
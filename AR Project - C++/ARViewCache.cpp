@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ARViewCache.h"
+
+#include "ARStats.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "SceneView.h"
+#include "UnrealClient.h"
+
+bool FARViewCache::UpdateFromPlayer(const APlayerController* playerController)
+{
+	valid = false;
+	const ULocalPlayer* localPlayer = playerController ? playerController->GetLocalPlayer() : nullptr;
+	if(!localPlayer || !localPlayer->ViewportClient) return false;
+
+	//Same projection data UGameplayStatics::DeprojectScreenToWorld builds, but only once a frame
+	FSceneViewProjectionData projectionData;
+	if(!localPlayer->GetProjectionData(localPlayer->ViewportClient->Viewport, projectionData)) return false;
+
+	inverseViewProjection = projectionData.ComputeViewProjectionMatrix().InverseFast();
+	viewRect = projectionData.GetConstrainedViewRect();
+	cameraLocation = projectionData.ViewOrigin;
+	cameraRotation = playerController->PlayerCameraManager ? playerController->PlayerCameraManager->GetCameraRotation().Quaternion()
+		: playerController->GetControlRotation().Quaternion();
+	frameNumber = GFrameCounter;
+	valid = true;
+	return true;
+}
+
+void FARViewCache::UpdateFromCamera(const FTransform& cameraTransform, float fieldOfView, const FVector2D& viewportSize)
+{
+	cameraLocation = cameraTransform.GetLocation();
+	cameraRotation = cameraTransform.GetRotation();
+	viewRect = FIntRect(0, 0, FMath::Max(FMath::RoundToInt(viewportSize.X), 1), FMath::Max(FMath::RoundToInt(viewportSize.Y), 1));
+
+	//Build the view the way the engine does, world axes swapped into view space with Z forward
+	const FMatrix viewMatrix = FTranslationMatrix(-cameraLocation)
+		* FInverseRotationMatrix(cameraRotation.Rotator())
+		* FMatrix(FPlane(0, 0, 1, 0), FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 0, 1));
+	const FMatrix projectionMatrix = FReversedZPerspectiveMatrix(FMath::DegreesToRadians(fieldOfView * 0.5f),
+		viewRect.Width(), viewRect.Height(), GNearClippingPlane);
+
+	inverseViewProjection = (viewMatrix * projectionMatrix).InverseFast();
+	frameNumber = GFrameCounter;
+	valid = true;
+}
+
+bool FARViewCache::Deproject(const FVector2D& screenPos, FVector& outWorldPos, FVector& outWorldDir) const
+{
+	if(!valid) return false;
+	INC_DWORD_STAT(STAT_AR_Deprojections);
+
+	FSceneView::DeprojectScreenToWorld(screenPos, viewRect, inverseViewProjection, outWorldPos, outWorldDir);
+	return true;
+}
+
+bool FARViewCache::DeprojectBatch(TArrayView<const FVector2D> screenPositions, TArrayView<FVector> outWorldPos, TArrayView<FVector> outWorldDir) const
+{
+	if(!valid || outWorldPos.Num() < screenPositions.Num() || outWorldDir.Num() < screenPositions.Num()) return false;
+	INC_DWORD_STAT_BY(STAT_AR_Deprojections, screenPositions.Num());
+
+	for(int32 index = 0; index < screenPositions.Num(); index++)
+	{
+		FSceneView::DeprojectScreenToWorld(screenPositions[index], viewRect, inverseViewProjection, outWorldPos[index], outWorldDir[index]);
+	}
+	return true;
+}
+
+//Deprojects a grid of screen points both ways and logs the cost per point
+static FAutoConsoleCommandWithWorldAndArgs ARDeprojectBenchCommand(
+	TEXT("ar.Bench.Deproject"),
+	TEXT("Deprojects a grid of screen points through UGameplayStatics one at a time and through a cached view in one batch. Usage: ar.Bench.Deproject [points, default 1024]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		const APlayerController* playerController = UGameplayStatics::GetPlayerController(world, 0);
+		const int32 points = FMath::Clamp(args.Num() > 0 ? FCString::Atoi(*args[0]) : 1024, 1, 1 << 20);
+
+		FIntPoint viewportSize(1080, 2340);
+		if(playerController)
+		{
+			playerController->GetViewportSize(viewportSize.X, viewportSize.Y);
+		}
+
+		TArray<FVector2D> screenPositions;
+		screenPositions.SetNumUninitialized(points);
+		const int32 columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(points)));
+		for(int32 index = 0; index < points; index++)
+		{
+			screenPositions[index] = FVector2D(viewportSize.X * ((index % columns) + 0.5f) / columns, viewportSize.Y * ((index / columns) + 0.5f) / columns);
+		}
+
+		TArray<FVector> worldPos, worldDir;
+		worldPos.SetNumUninitialized(points);
+		worldDir.SetNumUninitialized(points);
+
+		uint64 startCycles = FPlatformTime::Cycles64();
+		for(int32 index = 0; index < points; index++)
+		{
+			UGameplayStatics::DeprojectScreenToWorld(playerController, screenPositions[index], worldPos[index], worldDir[index]);
+		}
+		const double uncachedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+		startCycles = FPlatformTime::Cycles64();
+		FARViewCache viewCache;
+		const bool cached = viewCache.UpdateFromPlayer(playerController) && viewCache.DeprojectBatch(screenPositions, worldPos, worldDir);
+		const double cachedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+		UE_LOG(LogTemp, Display, TEXT("Deproject %i points: per call %.3f us each, cached batch %.3f us each%s"), points,
+			uncachedMs * 1000.0 / points, cachedMs * 1000.0 / points, cached ? TEXT("") : TEXT(" (no local player viewport, cache not filled)"));
+	}));
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class APlayerController;
+
+/**
+ * Camera pose and inverse view-projection captured once per frame, so every screen-space query of a frame
+ * deprojects with a matrix multiply instead of rebuilding the player's projection data each time.
+ * Filled from the local player's viewport on device and from the recorded camera during playback.
+ */
+class UE5_AR_API FARViewCache
+{
+public:
+	bool UpdateFromPlayer(const APlayerController* playerController);
+	void UpdateFromCamera(const FTransform& cameraTransform, float fieldOfView, const FVector2D& viewportSize);
+	void Invalidate() { frameNumber = MAX_uint64; }
+
+	//True when the cache was filled during the current frame
+	bool IsCurrent() const { return valid && frameNumber == GFrameCounter; }
+
+	bool Deproject(const FVector2D& screenPos, FVector& outWorldPos, FVector& outWorldDir) const;
+
+	//Deprojects every screen position with the same matrix, the output views must be as long as the input
+	bool DeprojectBatch(TArrayView<const FVector2D> screenPositions, TArrayView<FVector> outWorldPos, TArrayView<FVector> outWorldDir) const;
+
+	const FVector& GetCameraLocation() const { return cameraLocation; }
+	const FQuat& GetCameraRotation() const { return cameraRotation; }
+
+private:
+	FMatrix inverseViewProjection = FMatrix::Identity;
+	FIntRect viewRect;
+	FVector cameraLocation = FVector::ZeroVector;
+	FQuat cameraRotation = FQuat::Identity;
+	uint64 frameNumber = MAX_uint64;
+	bool valid = false;
+};
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BakeLevelLayoutsCommandlet.h"
+
+#include "ARGameplaySettings.h"
+#include "Level0.h"
+#include "LevelLayoutData.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+UBakeLevelLayoutsCommandlet::UBakeLevelLayoutsCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UBakeLevelLayoutsCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString levelList = TEXT("BP_Level0,BP_Level1,BP_Level2");
+	FParse::Value(*Params, TEXT("Levels="), levelList);
+
+	TArray<FString> levelNames;
+	levelList.ParseIntoArray(levelNames, TEXT(","));
+
+	//Spawn the blueprints into a throwaway editor world so their components are constructed, BeginPlay never runs
+	UWorld* world = UWorld::CreateWorld(EWorldType::Editor, false);
+	FWorldContext& worldContext = GEngine->CreateNewWorldContext(EWorldType::Editor);
+	worldContext.SetCurrentWorld(world);
+
+	int32 failures = 0;
+	TMap<FName, TSoftObjectPtr<ULevelLayoutData>> bakedLayouts;
+	for(const FString& levelName : levelNames)
+	{
+		const FString classPath = FString::Printf(TEXT("/Game/Blueprints/Levels/%s.%s_C"), *levelName, *levelName);
+		UClass* levelClass = LoadObject<UClass>(nullptr, *classPath);
+		if(!levelClass || !levelClass->IsChildOf<ALevel0>())
+		{
+			UE_LOG(LogTemp, Error, TEXT("BakeLevelLayouts: %s is not a level class"), *classPath);
+			failures++;
+			continue;
+		}
+
+		ALevel0* levelActor = world->SpawnActor<ALevel0>(levelClass, FTransform::Identity);
+		if(!levelActor)
+		{
+			failures++;
+			continue;
+		}
+
+		const FString packageName = ULevelLayoutData::GetBakedPackageName(levelName);
+		UPackage* package = CreatePackage(*packageName);
+		ULevelLayoutData* layout = NewObject<ULevelLayoutData>(package, *FPackageName::GetShortName(packageName), RF_Public | RF_Standalone);
+		levelActor->BakeLayout(layout);
+		levelActor->Destroy();
+
+		FAssetRegistryModule::AssetCreated(layout);
+		package->MarkPackageDirty();
+
+		FSavePackageArgs saveArgs;
+		saveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		const FString fileName = FPackageName::LongPackageNameToFilename(packageName, FPackageName::GetAssetPackageExtension());
+		if(!UPackage::SavePackage(package, layout, *fileName, saveArgs))
+		{
+			UE_LOG(LogTemp, Error, TEXT("BakeLevelLayouts: failed to save %s"), *fileName);
+			failures++;
+			continue;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("BakeLevelLayouts: %s baked with %i blocks and %i turrets"), *levelName,
+			layout->blockTransforms.Num(), layout->turretTransforms.Num());
+		bakedLayouts.Add(*levelName, TSoftObjectPtr<ULevelLayoutData>(layout));
+	}
+
+	//Saved to DefaultGame.ini so the game finds the layouts and the cook includes them
+	if(bakedLayouts.Num() > 0)
+	{
+		UARGameplaySettings* settings = GetMutableDefault<UARGameplaySettings>();
+		settings->bakedLayouts.Append(bakedLayouts);
+		settings->TryUpdateDefaultConfigFile();
+	}
+
+	GEngine->DestroyWorldContext(world);
+	world->DestroyWorld(false);
+	return failures > 0 ? 1 : 0;
+#else
+	return 1;
+#endif
+}
@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BakeLevelLayoutsCommandlet.generated.h"
+
+/**
+ * Bakes each level blueprint into a ULevelLayoutData asset next to it under Levels/Baked.
+ * Usage: UnrealEditor-Cmd <project> -run=BakeLevelLayouts [-Levels=BP_Level0,BP_Level1]
+ */
+UCLASS()
+class UE5_AR_API UBakeLevelLayoutsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBakeLevelLayoutsCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
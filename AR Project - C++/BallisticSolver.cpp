@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallisticSolver.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+namespace
+{
+	//Roots of a * t^2 + b * t + c = 0 in ascending order, a may be zero
+	int32 SolveQuadratic(float a, float b, float c, float outRoots[2])
+	{
+		if(FMath::IsNearlyZero(a))
+		{
+			if(FMath::IsNearlyZero(b)) return 0;
+			outRoots[0] = -c / b;
+			return 1;
+		}
+
+		const float discriminant = b * b - 4.f * a * c;
+		if(discriminant < 0.f) return 0;
+
+		const float root = FMath::Sqrt(discriminant);
+		const float first = (-b - root) / (2.f * a);
+		const float second = (-b + root) / (2.f * a);
+		outRoots[0] = FMath::Min(first, second);
+		outRoots[1] = FMath::Max(first, second);
+		return 2;
+	}
+
+	//Time range a linear coordinate spends between min and max, the whole line when it does not move on that axis
+	bool SolveSlab(float start, float speed, float min, float max, float& inTime, float& outTime)
+	{
+		if(FMath::IsNearlyZero(speed))
+		{
+			inTime = -UE_BIG_NUMBER;
+			outTime = UE_BIG_NUMBER;
+			return start >= min && start <= max;
+		}
+
+		inTime = (min - start) / speed;
+		outTime = (max - start) / speed;
+		if(inTime > outTime) Swap(inTime, outTime);
+		return true;
+	}
+}
+
+bool FBallisticPath::SolveDescendingTime(float height, float& outTime) const
+{
+	float roots[2];
+	const int32 count = SolveQuadratic(0.5f * gravityZ, velocity.Z, start.Z - height, roots);
+
+	//With gravity pulling down the later root is the one on the way down
+	for(int32 index = count - 1; index >= 0; index--)
+	{
+		if(roots[index] >= 0.f && velocity.Z + gravityZ * roots[index] <= 0.f)
+		{
+			outTime = roots[index];
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FBallisticPath::IntersectBox(const FBox& box, float maxTime, float& outTime) const
+{
+	//X and Y move linearly, so the path is over the box footprint for a single time range
+	float xIn, xOut, yIn, yOut;
+	if(!SolveSlab(start.X, velocity.X, box.Min.X, box.Max.X, xIn, xOut)) return false;
+	if(!SolveSlab(start.Y, velocity.Y, box.Min.Y, box.Max.Y, yIn, yOut)) return false;
+
+	const float rangeIn = FMath::Max3(xIn, yIn, 0.f);
+	const float rangeOut = FMath::Min3(xOut, yOut, maxTime);
+	if(rangeIn > rangeOut) return false;
+
+	//Z is quadratic, the path is inside the box at the start of the range or where it crosses the top or bottom face
+	float candidates[5] = { rangeIn };
+	int32 candidateCount = 1;
+	float roots[2];
+	for(const float faceHeight : { box.Min.Z, box.Max.Z })
+	{
+		const int32 count = SolveQuadratic(0.5f * gravityZ, velocity.Z, start.Z - faceHeight, roots);
+		for(int32 index = 0; index < count; index++)
+		{
+			if(roots[index] >= rangeIn && roots[index] <= rangeOut) candidates[candidateCount++] = roots[index];
+		}
+	}
+
+	float earliest = UE_BIG_NUMBER;
+	for(int32 index = 0; index < candidateCount; index++)
+	{
+		const float height = GetPosition(candidates[index]).Z;
+		if(height >= box.Min.Z - KINDA_SMALL_NUMBER && height <= box.Max.Z + KINDA_SMALL_NUMBER)
+		{
+			earliest = FMath::Min(earliest, candidates[index]);
+		}
+	}
+
+	if(earliest == UE_BIG_NUMBER) return false;
+	outTime = earliest;
+	return true;
+}
+
+void FBallisticPath::Sample(float duration, int32 count, TArray<FVector>& points) const
+{
+	points.Reset(count);
+	const float step = count > 1 ? duration / (count - 1) : 0.f;
+	for(int32 index = 0; index < count; index++)
+	{
+		points.Add(GetPosition(step * index));
+	}
+}
+
+namespace BallisticSolver
+{
+	FBallisticPrediction Predict(const FBallisticPath& path, TArrayView<const FBox> boxes, TOptional<float> groundHeight, float maxTime)
+	{
+		FBallisticPrediction prediction;
+		float endTime = maxTime;
+		if(groundHeight.IsSet() && path.SolveDescendingTime(groundHeight.GetValue(), prediction.landingTime) && prediction.landingTime <= maxTime)
+		{
+			endTime = prediction.landingTime;
+			prediction.landed = true;
+		}
+
+		for(int32 index = 0; index < boxes.Num(); index++)
+		{
+			float hitTime;
+			if(path.IntersectBox(boxes[index], endTime, hitTime))
+			{
+				endTime = hitTime;
+				prediction.hitIndex = index;
+				prediction.landed = true;
+			}
+		}
+
+		prediction.landingTime = endTime;
+		prediction.landingPoint = path.GetPosition(endTime);
+		return prediction;
+	}
+}
+
+//Solves random throws against a grid of boxes the size of a level and logs the throughput
+static FAutoConsoleCommand ARBallisticBenchCommand(
+	TEXT("ar.Bench.Ballistic"),
+	TEXT("Predicts random throws against a tower of boxes and logs solves per millisecond. Usage: ar.Bench.Ballistic [solves, default 10000] [boxes, default 100]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+	{
+		const int32 solves = FMath::Max(args.Num() > 0 ? FCString::Atoi(*args[0]) : 10000, 1);
+		const int32 boxCount = FMath::Max(args.Num() > 1 ? FCString::Atoi(*args[1]) : 100, 0);
+		FRandomStream random(42);
+
+		//Stack the boxes into a tower 300 units in front of the thrower
+		TArray<FBox> boxes;
+		boxes.Reserve(boxCount);
+		const int32 side = FMath::Max(FMath::CeilToInt(FMath::Pow(static_cast<float>(boxCount), 1.f / 3.f)), 1);
+		for(int32 index = 0; index < boxCount; index++)
+		{
+			const FVector corner(300.f + 10.f * (index % side), 10.f * ((index / side) % side) - 5.f * side, 10.f * (index / (side * side)));
+			boxes.Emplace(corner, corner + FVector(10.f));
+		}
+
+		TArray<FBallisticPath> paths;
+		paths.Reserve(solves);
+		for(int32 index = 0; index < solves; index++)
+		{
+			const FVector velocity(random.FRandRange(100.f, 500.f), random.FRandRange(-150.f, 150.f), random.FRandRange(0.f, 150.f));
+			paths.Emplace(FVector(0.f, 0.f, 20.f), velocity, -980.f);
+		}
+
+		int32 hits = 0;
+		const uint64 startCycles = FPlatformTime::Cycles64();
+		for(const FBallisticPath& path : paths)
+		{
+			hits += BallisticSolver::Predict(path, boxes, 0.f, 5.f).hitIndex != INDEX_NONE ? 1 : 0;
+		}
+		const double elapsedMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+		UE_LOG(LogTemp, Display, TEXT("Ballistic solver: %i solves against %i boxes in %.3f ms, %.0f solves/ms, %i hit a box"),
+			solves, boxCount, elapsedMs, elapsedMs > 0.0 ? solves / elapsedMs : 0.0, hits);
+	}));
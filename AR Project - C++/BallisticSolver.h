@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Optional.h"
+
+/**
+ * Closed-form flight of a projectile under constant gravity, p(t) = start + velocity * t + 0.5 * gravity * t^2.
+ * Drag is ignored, so the prediction matches the simulation for the short, slow throws the game uses.
+ */
+struct UE5_AR_API FBallisticPath
+{
+	FVector start = FVector::ZeroVector;
+	FVector velocity = FVector::ZeroVector;
+	float gravityZ = -980.f;
+
+	FBallisticPath() = default;
+	FBallisticPath(const FVector& inStart, const FVector& inVelocity, float inGravityZ) : start(inStart), velocity(inVelocity), gravityZ(inGravityZ) {}
+
+	FVector GetPosition(float time) const
+	{
+		return start + velocity * time + FVector(0.f, 0.f, 0.5f * gravityZ * time * time);
+	}
+
+	//First time after now the path comes down through the given height, false when it never reaches it
+	bool SolveDescendingTime(float height, float& outTime) const;
+
+	//First time the path is inside the box, starting inside counts as zero
+	bool IntersectBox(const FBox& box, float maxTime, float& outTime) const;
+
+	//Fills points with count evenly spaced positions over duration, the buffer keeps its allocation between calls
+	void Sample(float duration, int32 count, TArray<FVector>& points) const;
+};
+
+struct FBallisticPrediction
+{
+	FVector landingPoint = FVector::ZeroVector;
+	float landingTime = 0.f;
+	int32 hitIndex = INDEX_NONE;
+	bool landed = false;
+};
+
+namespace BallisticSolver
+{
+	//Earliest of the boxes the path enters before it comes down through groundHeight, boxes are tested in closed form.
+	//Without a ground height the path runs until it hits a box or maxTime
+	UE5_AR_API FBallisticPrediction Predict(const FBallisticPath& path, TArrayView<const FBox> boxes, TOptional<float> groundHeight, float maxTime);
+}
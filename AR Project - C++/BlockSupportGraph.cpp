@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlockSupportGraph.h"
+
+void FBlockSupportGraph::Build(TArrayView<const FBox> blockBounds, float contactTolerance)
+{
+	const int32 numBlocks = blockBounds.Num();
+	grounded.Init(false, numBlocks);
+	neighbourOffsets.Reset(numBlocks + 1);
+	neighbourIndices.Reset();
+	if(numBlocks == 0)
+	{
+		neighbourOffsets.Add(0);
+		ResetState();
+		return;
+	}
+
+	//Cell size from the average block so each block only lands in a handful of cells
+	FBox towerBounds(ForceInit);
+	FVector averageSize = FVector::ZeroVector;
+	for(const FBox& bounds : blockBounds)
+	{
+		towerBounds += bounds;
+		averageSize += bounds.GetSize();
+	}
+	averageSize /= numBlocks;
+	const float cellSize = FMath::Max(averageSize.GetMax(), KINDA_SMALL_NUMBER);
+
+	auto toCell = [&towerBounds, cellSize](const FVector& point)
+	{
+		const FVector local = (point - towerBounds.Min) / cellSize;
+		return FIntVector(FMath::FloorToInt(local.X), FMath::FloorToInt(local.Y), FMath::FloorToInt(local.Z));
+	};
+
+	TMap<FIntVector, TArray<int32, TInlineAllocator<4>>> grid;
+	grid.Reserve(numBlocks);
+	for(int32 block = 0; block < numBlocks; block++)
+	{
+		const FBox expanded = blockBounds[block].ExpandBy(contactTolerance);
+		const FIntVector minCell = toCell(expanded.Min);
+		const FIntVector maxCell = toCell(expanded.Max);
+		for(int32 x = minCell.X; x <= maxCell.X; x++)
+		for(int32 y = minCell.Y; y <= maxCell.Y; y++)
+		for(int32 z = minCell.Z; z <= maxCell.Z; z++)
+		{
+			grid.FindOrAdd(FIntVector(x, y, z)).Add(block);
+		}
+	}
+
+	//Blocks sitting on the lowest level of the tower are what hold it up
+	const float groundHeight = towerBounds.Min.Z + contactTolerance;
+	TArray<int32, TInlineAllocator<32>> candidates;
+	
+	for(int32 block = 0; block < numBlocks; block++)
+	{
+		neighbourOffsets.Add(neighbourIndices.Num());
+		grounded[block] = blockBounds[block].Min.Z <= groundHeight;
+
+		const FBox expanded = blockBounds[block].ExpandBy(contactTolerance);
+		const FIntVector minCell = toCell(expanded.Min);
+		const FIntVector maxCell = toCell(expanded.Max);
+		
+		candidates.Reset();
+		for(int32 x = minCell.X; x <= maxCell.X; x++)
+		for(int32 y = minCell.Y; y <= maxCell.Y; y++)
+		for(int32 z = minCell.Z; z <= maxCell.Z; z++)
+		{
+			if(const auto* cell = grid.Find(FIntVector(x, y, z)))
+			{
+				for(int32 other : *cell)
+				{
+					if(other != block) candidates.AddUnique(other);
+				}
+			}
+		}
+
+		for(int32 other : candidates)
+		{
+			if(expanded.Intersect(blockBounds[other]))
+			{
+				neighbourIndices.Add(other);
+			}
+		}
+	}
+	neighbourOffsets.Add(neighbourIndices.Num());
+
+	ResetState();
+}
+
+void FBlockSupportGraph::BuildFromAdjacency(TArrayView<const int32> inNeighbourOffsets, TArrayView<const int32> inNeighbourIndices, TArrayView<const bool> inGrounded)
+{
+	neighbourOffsets.Reset();
+	neighbourOffsets.Append(inNeighbourOffsets.GetData(), inNeighbourOffsets.Num());
+	neighbourIndices.Reset();
+	neighbourIndices.Append(inNeighbourIndices.GetData(), inNeighbourIndices.Num());
+	grounded.Reset();
+	grounded.Append(inGrounded.GetData(), inGrounded.Num());
+	ResetState();
+}
+
+void FBlockSupportGraph::ResetState()
+{
+	removed.Init(false, grounded.Num());
+	parent.SetNumUninitialized(grounded.Num());
+	componentGrounded.SetNumUninitialized(grounded.Num());
+	dirty = false;
+}
+
+void FBlockSupportGraph::RemoveNode(int32 node)
+{
+	if(!removed.IsValidIndex(node) || removed[node]) return;
+	
+	removed[node] = true;
+	dirty = true;
+}
+
+void FBlockSupportGraph::CollectUnsupported(TArray<int32>& outUnsupported)
+{
+	if(!dirty) return;
+	dirty = false;
+
+	//Union-find does not support deleting edges, so rebuild the sets over the blocks still standing
+	const int32 numNodes = grounded.Num();
+	for(int32 node = 0; node < numNodes; node++)
+	{
+		parent[node] = node;
+	}
+	
+	for(int32 node = 0; node < numNodes; node++)
+	{
+		if(removed[node]) continue;
+		for(int32 neighbour : GetNeighbours(node))
+		{
+			if(neighbour > node && !removed[neighbour])
+			{
+				Union(node, neighbour);
+			}
+		}
+	}
+
+	for(int32 node = 0; node < numNodes; node++)
+	{
+		componentGrounded[node] = false;
+	}
+	for(int32 node = 0; node < numNodes; node++)
+	{
+		if(!removed[node] && grounded[node])
+		{
+			componentGrounded[Find(node)] = true;
+		}
+	}
+
+	//Anything whose set has no grounded block is hanging in the air, release the whole cluster
+	for(int32 node = 0; node < numNodes; node++)
+	{
+		if(!removed[node] && !componentGrounded[Find(node)])
+		{
+			removed[node] = true;
+			outUnsupported.Add(node);
+		}
+	}
+}
+
+TConstArrayView<int32> FBlockSupportGraph::GetNeighbours(int32 node) const
+{
+	const int32 start = neighbourOffsets[node];
+	return TConstArrayView<int32>(neighbourIndices.GetData() + start, neighbourOffsets[node + 1] - start);
+}
+
+int32 FBlockSupportGraph::Find(int32 node)
+{
+	//Path halving keeps the trees flat without recursion
+	while(parent[node] != node)
+	{
+		parent[node] = parent[parent[node]];
+		node = parent[node];
+	}
+	return node;
+}
+
+void FBlockSupportGraph::Union(int32 a, int32 b)
+{
+	const int32 rootA = Find(a);
+	const int32 rootB = Find(b);
+	if(rootA == rootB) return;
+
+	//Attach the higher index root under the lower one, which is enough with path halving
+	if(rootA < rootB) parent[rootB] = rootA;
+	else parent[rootA] = rootB;
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Adjacency and support graph for the blocks of a tower. Nodes are blocks, edges join blocks whose
+ * bounds touch and grounded nodes rest on the base of the tower. Removing blocks marks the graph dirty
+ * and the next CollectUnsupported rebuilds connectivity with a union-find over the remaining blocks,
+ * returning every block no longer connected to the ground so whole clusters can be released at once.
+ */
+class UE5_AR_API FBlockSupportGraph
+{
+public:
+	//Builds the adjacency from block bounds using a uniform grid so large towers avoid the n^2 pair test
+	void Build(TArrayView<const FBox> blockBounds, float contactTolerance);
+
+	//Builds from a precomputed adjacency, neighbourOffsets has one entry per node plus a terminating entry
+	void BuildFromAdjacency(TArrayView<const int32> inNeighbourOffsets, TArrayView<const int32> inNeighbourIndices, TArrayView<const bool> inGrounded);
+
+	void RemoveNode(int32 node);
+
+	//Undoes every RemoveNode, the adjacency is kept so a level restart does not rebuild it
+	void RestoreAll() { ResetState(); }
+	void CollectUnsupported(TArray<int32>& outUnsupported);
+
+	bool IsDirty() const { return dirty; }
+	bool IsRemoved(int32 node) const { return removed[node]; }
+	int32 Num() const { return grounded.Num(); }
+	TConstArrayView<int32> GetNeighbours(int32 node) const;
+
+	const TArray<int32>& GetNeighbourOffsets() const { return neighbourOffsets; }
+	const TArray<int32>& GetNeighbourIndices() const { return neighbourIndices; }
+	const TArray<bool>& GetGrounded() const { return grounded; }
+
+private:
+	void ResetState();
+	int32 Find(int32 node);
+	void Union(int32 a, int32 b);
+
+	//Compressed adjacency, the neighbours of node i are neighbourIndices[neighbourOffsets[i] .. neighbourOffsets[i + 1])
+	TArray<int32> neighbourOffsets;
+	TArray<int32> neighbourIndices;
+	TArray<bool> grounded;
+	TArray<bool> removed;
+	
+	TArray<int32> parent;
+	TArray<bool> componentGrounded;
+	bool dirty = false;
+};
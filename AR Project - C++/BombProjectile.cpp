@@ -3,8 +3,15 @@
 
 #include "BombProjectile.h"
 
+#include "ARCollisionChannels.h"
+#include "ARGameplayAssets.h"
+#include "ARStats.h"
+#include "ContactDamageSubsystem.h"
+#include "GameplayActorPool.h"
+#include "GameplayEventSubsystem.h"
 #include "cmath"
 #include "Level0.h"
+#include "GameplayServicesSubsystem.h"
 #include "Components/AudioComponent.h"
 #include "Kismet/GameplayStatics.h"
 
@@ -16,26 +23,13 @@ ABombProjectile::ABombProjectile()
 	micComponent = CreateDefaultSubobject<UAudioComponent>(TEXT("MicrophoneComponent"));
 	micComponent->bAutoActivate = true;
 
-	auto MeshAsset = ConstructorHelpers::FObjectFinder<UStaticMesh>(TEXT("StaticMesh'/Engine/BasicShapes/Sphere.Sphere'"));
-	staticMeshComponent->SetStaticMesh(MeshAsset.Object);
+	//Shared mesh and materials, the bomb starts unlit and swaps to the lit material when sparked
+	const FARGameplayAssets& assets = FARGameplayAssets::Get();
+	staticMeshComponent->SetStaticMesh(assets.sphereMesh);
+	staticMeshComponent->SetMaterial(0, assets.bombMaterialUnlit);
 
-	//Set the material
-	ConstructorHelpers::FObjectFinder<UMaterial>FoundMaterial(TEXT("Material'/Game/Assets/Materials/BombProjectileMat.BombProjectileMat'"));
-
-	if(FoundMaterial.Succeeded())
-	{
-		projectileMaterialLit = FoundMaterial.Object;
-	}
-	
-	ConstructorHelpers::FObjectFinder<UMaterial>FoundMaterial2(TEXT("Material'/Game/Assets/Materials/BombProjectileUnlit.BombProjectileUnlit'"));
-	
-	if(FoundMaterial2.Succeeded())
-	{
-		projectileMaterialUnlit = FoundMaterial2.Object;
-	}
-	
-	projectileMatInstance = UMaterialInstanceDynamic::Create(projectileMaterialUnlit, staticMeshComponent);
-	staticMeshComponent->SetMaterial(0, projectileMatInstance);
+	//Lets the contact callback pick the bomb out of the contact pairs and limits what it collides with
+	ARCollision::ConfigurePlayerProjectile(staticMeshComponent);
 }
 
 void ABombProjectile::PostInitializeComponents()
@@ -56,10 +50,65 @@ void ABombProjectile::BeginPlay()
 {
 	Super::BeginPlay();
 
-	voiceCapture = FVoiceModule::Get().CreateVoiceCapture("",44100, 1);
-	if(voiceCapture.IsValid())
+	RegisterWithServices();
+}
+
+void ABombProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterFromServices();
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+void ABombProjectile::SetPooled(bool pooled)
+{
+	if(!pooled)
 	{
-		bool success = voiceCapture->Start();
+		RegisterWithServices();
+		return;
+	}
+
+	UnregisterFromServices();
+	sparking = false;
+	elapsedTime = 0.f;
+	staticMeshComponent->SetMaterial(0, FARGameplayAssets::Get().bombMaterialUnlit);
+}
+
+void ABombProjectile::RegisterWithServices()
+{
+	//The game mode keeps the capture device open between bombs, opening it here was a hitch on the first bomb
+	const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+	voiceCaptureOwner = services ? services->GetGameMode() : nullptr;
+	if(!voiceCapture.IsValid())
+	{
+		voiceCapture = voiceCaptureOwner ? voiceCaptureOwner->AcquireVoiceCapture() : nullptr;
+	}
+
+	if(!usesContactDamage && UContactDamageSubsystem::IsEnabled())
+	{
+		if(UContactDamageSubsystem* contactDamage = GetWorld()->GetSubsystem<UContactDamageSubsystem>())
+		{
+			contactDamage->RegisterProjectile(staticMeshComponent, FOnProjectileBlockContact::CreateUObject(this, &ABombProjectile::OnBlockContact));
+			usesContactDamage = true;
+		}
+	}
+}
+
+void ABombProjectile::UnregisterFromServices()
+{
+	if(voiceCapture.IsValid() && voiceCaptureOwner)
+	{
+		voiceCaptureOwner->ReleaseVoiceCapture();
+	}
+	voiceCapture.Reset();
+	
+	if(usesContactDamage)
+	{
+		if(UContactDamageSubsystem* contactDamage = GetWorld()->GetSubsystem<UContactDamageSubsystem>())
+		{
+			contactDamage->UnregisterProjectile(staticMeshComponent);
+		}
+		usesContactDamage = false;
 	}
 }
 
@@ -72,6 +121,7 @@ void ABombProjectile::Tick(float DeltaSeconds)
 
 void ABombProjectile::VoiceCaptureTick()
 {
+	AR_SCOPED_STAT(VoiceCaptureTick);
 	if(!voiceCapture.IsValid())
 	{
 		return;
@@ -87,7 +137,8 @@ void ABombProjectile::VoiceCaptureTick()
 		uint32 voiceCaptureReadBytes = 0;
 		float voiceCaptureTotalSquared = 0.f;
 		
-		voiceCaptureBuffer.SetNumUninitialized(voiceCaptureBytesAvailable);
+		//Never shrink, the buffer settles at the largest capture and stops reallocating
+		voiceCaptureBuffer.SetNumUninitialized(voiceCaptureBytesAvailable, false);
 		
 		voiceCapture->GetVoiceData(voiceCaptureBuffer.GetData(), voiceCaptureBytesAvailable, voiceCaptureReadBytes);
 
@@ -128,43 +179,81 @@ void ABombProjectile::VoiceCaptureTick()
 
 void ABombProjectile::NotifyHit(UPrimitiveComponent* comp, AActor* other, UPrimitiveComponent* otherComp, bool bSelfMoved, FVector hitLocation, FVector hitNormal, FVector normalImpulse, const FHitResult& hit)
 {
+	AR_SCOPED_STAT(ProjectileNotifyHit);
+	INC_DWORD_STAT(STAT_AR_HitEvents);
+
+	//Blocks are handled by OnBlockContact from the drained physics thread contacts
+	if(usesContactDamage && otherComp && otherComp->GetCollisionObjectType() == ARCollision::Block) return;
+	
 	// Check if the hit actor is a level block (primitive cube mesh)
-	if (other && other->IsA(ALevel0::StaticClass()))
+	if (ALevel0* LevelBlock = Cast<ALevel0>(other))
 	{
-		ALevel0* LevelBlock = Cast<ALevel0>(other);
-		if (LevelBlock)
-		{
-			UStaticMeshComponent* OtherMeshComp = Cast<UStaticMeshComponent>(hit.Component.Get());
+		UStaticMeshComponent* OtherMeshComp = Cast<UStaticMeshComponent>(hit.Component.Get());
 
-			if (LevelBlock->GetIsPlatform()) return;
+		if (LevelBlock->GetIsPlatform()) return;
 
-			// Call the collision response function
-			LevelBlock->DecrementHealth(OtherMeshComp, damage);
-		}
+		// Call the collision response function
+		LevelBlock->DecrementHealth(OtherMeshComp, damage);
 	}
 
+	Detonate(hitLocation);
+}
+
+void ABombProjectile::OnBlockContact(ALevel0* level, UStaticMeshComponent* block, const FVector& location)
+{
+	if(level->GetIsPlatform()) return;
+	
+	level->DecrementHealth(block, damage);
+	Detonate(location);
+}
+
+void ABombProjectile::Detonate(const FVector& location)
+{
 	if(playerProjectile)
 	{
 		//Differentiate between the player and enemy throwing projectiles
 		if(playerProjectile)
 		{
-			AThePlayer* playerRef = customGameMode->GetPlayerReference();
-			playerRef->IncrementScore(scoreIncrement);
+			//Queued, a bomb touching several blocks in one frame still only updates the score once
+			if(UGameplayEventSubsystem* gameplayEvents = UGameplayEventSubsystem::Get(this))
+			{
+				gameplayEvents->AddScore(scoreIncrement);
+			}
+			else
+			{
+				const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+				if(AThePlayer* playerRef = services ? services->GetPlayer() : nullptr)
+				{
+					playerRef->IncrementScore(scoreIncrement);
+				}
+			}
 			playerProjectile = false;
 		}
 	}
 
 	// Apply explosive force
-	ApplyExplosiveForce(hitLocation);
+	ApplyExplosiveForce(location);
 
-	// Destroy the projectile
-	Destroy();
+	//Back to the pool for the next bomb, destroyed only when there is no pool
+	const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+	ACustomGameMode* gameMode = services ? services->GetGameMode() : nullptr;
+	UGameplayActorPool* actorPool = gameMode ? gameMode->GetActorPool() : nullptr;
+	if(actorPool)
+	{
+		actorPool->Release(this);
+	}
+	else
+	{
+		Destroy();
+	}
 }
 
 void ABombProjectile::ApplyExplosiveForce(const FVector& ExplosionLocation)
 {
+	AR_SCOPED_STAT(ApplyExplosiveForce);
 	// Define parameters for the sweep
 	float ExplosionRadius = 20.f; // Adjust the radius as needed
+	float ExplosionReach = 60.f; // Kinematic blocks within this distance are woken up by the blast
 
 	// Setup the collision parameters
 	FCollisionQueryParams Params;
@@ -172,9 +261,9 @@ void ABombProjectile::ApplyExplosiveForce(const FVector& ExplosionLocation)
 	Params.bTraceComplex = false;
 
 	// Perform the radial sweep to find level blocks
-	TArray<FHitResult> HitResults;
+	explosionHits.Reset();
 	bool bHit = GetWorld()->SweepMultiByChannel(
-		HitResults,
+		explosionHits,
 		ExplosionLocation,
 		ExplosionLocation,
 		FQuat::Identity,
@@ -183,17 +272,20 @@ void ABombProjectile::ApplyExplosiveForce(const FVector& ExplosionLocation)
 		Params
 	);
 
-	// Iterate over the hit results
-	for (const FHitResult& SweepResult : HitResults)
+	// Iterate over the hit results, each block of a level is a separate hit so only handle each level once
+	TArray<ALevel0*, TInlineAllocator<4>> HandledLevels;
+	for (const FHitResult& SweepResult : explosionHits)
 	{
 		ALevel0* LevelBlock = Cast<ALevel0>(SweepResult.GetActor());
-		if (LevelBlock)
+		if (LevelBlock && !HandledLevels.Contains(LevelBlock))
 		{
-			TArray<UStaticMeshComponent*> BlockMeshComponents;
-			LevelBlock->GetComponents<UStaticMeshComponent>(BlockMeshComponents);
+			HandledLevels.Add(LevelBlock);
+			
+			// Wake the blocks the blast reaches, kinematic blocks ignore impulses
+			LevelBlock->ActivateBlocksInRadius(ExplosionLocation, ExplosionReach);
 
-			// Iterate through all static mesh components in the level block
-			for (UStaticMeshComponent* BlockMeshComponent : BlockMeshComponents)
+			// Iterate through the simulating blocks in the level
+			for (UStaticMeshComponent* BlockMeshComponent : LevelBlock->GetActiveBlocks())
 			{
 				// Calculate the direction from the level block to the bomb projectile
 				FVector ExplosionDirection = BlockMeshComponent->GetComponentLocation() - ExplosionLocation;
@@ -248,10 +340,7 @@ void ABombProjectile::SparkBomb()
 	//Set the bomb to sparking or extinguish
 	sparking = !sparking;
 
-	// Create dynamic material instances
-	UMaterialInstanceDynamic* projectileMatInstanceLit = UMaterialInstanceDynamic::Create(projectileMaterialLit, staticMeshComponent);
-	// UMaterialInstanceDynamic* projectileMatInstanceUnlit = UMaterialInstanceDynamic::Create(projectileMaterialUnlit, staticMeshComponent);
-	staticMeshComponent->SetMaterial(0, projectileMatInstanceLit);
+	staticMeshComponent->SetMaterial(0, FARGameplayAssets::Get().bombMaterialLit);
 	
 	//GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Yellow, (TEXT("Sparking!!!")));
 }
@@ -7,6 +7,9 @@
 #include "Projectile.h"
 #include "BombProjectile.generated.h"
 
+class ACustomGameMode;
+class ALevel0;
+
 /**
  * 
  */
@@ -22,31 +25,43 @@ public:
 	
 	virtual void NotifyHit(class UPrimitiveComponent* comp, AActor* other, UPrimitiveComponent* otherComp, bool bSelfMoved,
 	FVector hitLocation, FVector hitNormal, FVector normalImpulse, const FHitResult& hit) override;
+
+	//Called by the actor pool, a pooled bomb lets go of the capture device and its contacts and starts unlit again
+	void SetPooled(bool pooled);
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void PostInitializeComponents() override;
 	void VoiceCaptureTick();
 	float DetermineAmplitude(const TArray<uint8>& audioData);
 	float DetermineFrequency(const TArray<uint8>& audioData);
 
 private:
+	void RegisterWithServices();
+	void UnregisterFromServices();
 	void SparkBomb();
 	void ApplyExplosiveForce(const FVector& ExplosionLocation);
+	void OnBlockContact(ALevel0* level, UStaticMeshComponent* block, const FVector& location);
+	void Detonate(const FVector& location);
 	
 	TSharedPtr<IVoiceCapture> voiceCapture;
+	ACustomGameMode* voiceCaptureOwner = nullptr;
 	TArray<uint8> voiceCaptureBuffer;
 	float voiceCaptureVolume;
 	UAudioComponent* micComponent;
-	UMaterial* projectileMaterialLit;
-	UMaterial* projectileMaterialUnlit;
-	UMaterialInstanceDynamic* projectileMatInstance;
 	
 	//Const threshold value for the detecting of blowing sounds
 	const float blowingThreshold = 90.f;
 	const float frequencyThreshold = 8000.f; // Hz
 	bool sparking = false;
 
+	//Block hits come from the physics thread contact callback instead of NotifyHit
+	bool usesContactDamage = false;
+
+	//Sweep results of the explosion, kept with the bomb rather than shared between worlds
+	TArray<FHitResult> explosionHits;
+
 	float captureInterval = 0.5f;
 	float elapsedTime = 0.f;
 	int damage = 100;
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ContactDamageBuffer.h"
+
+#include "HAL/PlatformProcess.h"
+
+FContactDamageBuffer::FContactDamageBuffer()
+	: writeSide(0)
+	, writing(false)
+	, pairsFiltered(0)
+	, callbacks(0)
+{
+	for(int32 side = 0; side < 2; side++)
+	{
+		events[side].SetNumUninitialized(capacity);
+		counts[side].store(0);
+	}
+}
+
+void FContactDamageBuffer::Push(const FContactDamageEvent& event)
+{
+	//The flag tells the game thread a push is in flight on whichever side was read below
+	writing.store(true);
+	const int32 side = writeSide.load();
+	const int32 slot = counts[side].fetch_add(1);
+	if(slot < capacity)
+	{
+		events[side][slot] = event;
+	}
+	writing.store(false);
+}
+
+uint32 FContactDamageBuffer::Drain(TArray<FContactDamageEvent>& outEvents)
+{
+	const int32 readSide = writeSide.load();
+	writeSide.store(1 - readSide);
+
+	//A push that read the old side before the swap may still be writing to it, any later push goes to the new side
+	while(writing.load())
+	{
+		FPlatformProcess::YieldThread();
+	}
+
+	const int32 pushed = counts[readSide].exchange(0);
+	const int32 stored = FMath::Min(pushed, capacity);
+	outEvents.Append(events[readSide].GetData(), stored);
+	return static_cast<uint32>(pushed - stored);
+}
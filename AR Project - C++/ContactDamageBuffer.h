@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+//A projectile touching a block, recorded on the physics thread. The owners are the components the bodies
+//belong to, only used as keys on the game thread and never dereferenced, they may be gone by the time it drains
+struct FContactDamageEvent
+{
+	const UObject* projectileOwner = nullptr;
+	const UObject* blockOwner = nullptr;
+	FVector location = FVector::ZeroVector;
+};
+
+/**
+ * Single producer, single consumer double buffer. The physics thread pushes contacts into the write side
+ * without locking and the game thread swaps sides once a frame and reads the batch the physics steps
+ * since the last swap produced. Each side has a fixed capacity so pushing never allocates, contacts over
+ * the capacity are counted and dropped.
+ */
+class UE5_AR_API FContactDamageBuffer
+{
+public:
+	static constexpr int32 capacity = 512;
+
+	FContactDamageBuffer();
+
+	//Physics thread
+	void Push(const FContactDamageEvent& event);
+	void AddPairsFiltered(uint32 count) { pairsFiltered.fetch_add(count, std::memory_order_relaxed); }
+	void AddCallback() { callbacks.fetch_add(1, std::memory_order_relaxed); }
+
+	//Game thread, appends everything pushed since the last drain and returns how many were dropped
+	uint32 Drain(TArray<FContactDamageEvent>& outEvents);
+
+	uint64 GetPairsFiltered() const { return pairsFiltered.load(std::memory_order_relaxed); }
+	uint64 GetCallbacks() const { return callbacks.load(std::memory_order_relaxed); }
+
+private:
+	TArray<FContactDamageEvent> events[2];
+	std::atomic<int32> counts[2];
+	std::atomic<int32> writeSide;
+	std::atomic<bool> writing;
+	std::atomic<uint64> pairsFiltered;
+	std::atomic<uint64> callbacks;
+};
@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ContactDamageSubsystem.h"
+
+#include "ARCollisionChannels.h"
+#include "ARStats.h"
+#include "Level0.h"
+#include "Chaos/ContactModification.h"
+#include "Chaos/ParticleHandle.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/World.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "Physics/PhysicsFiltering.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+#include "PBDRigidsSolver.h"
+
+static TAutoConsoleVariable<int32> CVarPhysicsThreadDamage(
+	TEXT("ar.PhysicsThreadDamage"), 1,
+	TEXT("1 resolves projectile against block damage from a physics thread contact callback, 0 uses NotifyHit on every block. Applies to projectiles and levels spawned afterwards."));
+
+/**
+ * Runs inside the solver step on the physics thread. Only reads the shape filter data of each contact pair,
+ * the contacts themselves are left unmodified.
+ */
+class FContactDamageCallback : public Chaos::TSimCallbackObject<Chaos::FSimCallbackNoInput, Chaos::FSimCallbackNoOutput, Chaos::ESimCallbackOptions::ContactModification>
+{
+public:
+	FContactDamageBuffer* buffer = nullptr;
+
+private:
+	virtual void OnPreSimulate_Internal() override {}
+
+	virtual void OnContactModification_Internal(Chaos::FCollisionContactModifier& modifier) override
+	{
+		if(!buffer) return;
+		buffer->AddCallback();
+
+		uint32 pairCount = 0;
+		for(Chaos::FContactPairModifier& pair : modifier.GetContacts())
+		{
+			pairCount++;
+			const Chaos::TVec2<Chaos::FGeometryParticleHandle*> particles = pair.GetParticlePair();
+			const ECollisionChannel channel0 = GetChannel(particles[0]);
+			const ECollisionChannel channel1 = GetChannel(particles[1]);
+
+			int32 projectileIndex = INDEX_NONE;
+			if(ARCollision::IsProjectile(channel0) && channel1 == ARCollision::Block) projectileIndex = 0;
+			else if(ARCollision::IsProjectile(channel1) && channel0 == ARCollision::Block) projectileIndex = 1;
+			if(projectileIndex == INDEX_NONE || pair.GetNumContacts() == 0) continue;
+
+			const IPhysicsProxyBase* projectileProxy = particles[projectileIndex]->PhysicsProxy();
+			const IPhysicsProxyBase* blockProxy = particles[1 - projectileIndex]->PhysicsProxy();
+			if(!projectileProxy || !blockProxy) continue;
+
+			Chaos::FVec3 location0, location1;
+			pair.GetWorldContactLocations(0, location0, location1);
+
+			FContactDamageEvent event;
+			event.projectileOwner = projectileProxy->GetOwner();
+			event.blockOwner = blockProxy->GetOwner();
+			event.location = FVector(projectileIndex == 0 ? location0 : location1);
+			buffer->Push(event);
+		}
+		buffer->AddPairsFiltered(pairCount);
+	}
+
+	static ECollisionChannel GetChannel(const Chaos::FGeometryParticleHandle* particle)
+	{
+		if(!particle) return ECC_MAX;
+		
+		const Chaos::FShapesArray& shapes = particle->ShapesArray();
+		return shapes.Num() > 0 ? GetCollisionChannel(shapes[0]->GetQueryData().Word3) : ECC_MAX;
+	}
+};
+
+bool UContactDamageSubsystem::IsEnabled()
+{
+	return CVarPhysicsThreadDamage.GetValueOnGameThread() != 0;
+}
+
+void UContactDamageSubsystem::OnWorldBeginPlay(UWorld& inWorld)
+{
+	Super::OnWorldBeginPlay(inWorld);
+	if(!IsEnabled()) return;
+
+	FPhysScene_Chaos* physScene = inWorld.GetPhysicsScene();
+	Chaos::FPhysicsSolver* solver = physScene ? physScene->GetSolver() : nullptr;
+	if(!solver) return;
+
+	callback = solver->CreateAndRegisterSimCallbackObject_External<FContactDamageCallback>();
+	callback->buffer = &buffer;
+}
+
+void UContactDamageSubsystem::Deinitialize()
+{
+	UWorld* world = GetWorld();
+	FPhysScene_Chaos* physScene = world ? world->GetPhysicsScene() : nullptr;
+	if(callback && physScene && physScene->GetSolver())
+	{
+		physScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(callback);
+	}
+	callback = nullptr;
+	
+	Super::Deinitialize();
+}
+
+void UContactDamageSubsystem::Tick(float DeltaTime)
+{
+	if(!callback) return;
+
+	const uint64 pairsFiltered = buffer.GetPairsFiltered();
+	INC_DWORD_STAT_BY(STAT_AR_ContactPairs, pairsFiltered - lastPairsFiltered);
+	lastPairsFiltered = pairsFiltered;
+
+	ApplyContacts();
+}
+
+void UContactDamageSubsystem::ApplyContacts()
+{
+	AR_SCOPED_STAT(ContactDamageApply);
+
+	drained.Reset();
+	const uint32 dropped = buffer.Drain(drained);
+	INC_DWORD_STAT_BY(STAT_AR_ContactEventsDropped, dropped);
+	if(drained.Num() == 0) return;
+
+	INC_DWORD_STAT_BY(STAT_AR_ContactDamageEvents, drained.Num());
+	totalEvents += drained.Num();
+
+	//Several solver steps can report the same pair, each projectile and block pair is handled once per batch
+	handledPairs.Reset();
+	for(const FContactDamageEvent& event : drained)
+	{
+		bool alreadyHandled = false;
+		handledPairs.Add(TPair<const UObject*, const UObject*>(event.projectileOwner, event.blockOwner), &alreadyHandled);
+		if(alreadyHandled) continue;
+
+		//Either side may have been unregistered by an earlier contact in this batch, e.g. a bomb detonating
+		const FRegisteredProjectile* projectile = projectiles.Find(event.projectileOwner);
+		const FRegisteredBlock* block = blocks.Find(event.blockOwner);
+		if(!projectile || !block || !projectile->component.IsValid() || !block->level.IsValid() || !block->component.IsValid()) continue;
+
+		UE_LOG(LogTemp, Verbose, TEXT("Contact damage: %s hit %s of %s"), *projectile->component->GetOwner()->GetName(),
+			*block->component->GetName(), *block->level->GetName());
+
+		//Copy the delegate, the handler is allowed to unregister its projectile
+		const FOnProjectileBlockContact onContact = projectile->onContact;
+		onContact.ExecuteIfBound(block->level.Get(), block->component.Get(), event.location);
+	}
+}
+
+TStatId UContactDamageSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UContactDamageSubsystem, STATGROUP_Tickables);
+}
+
+//The flag is kept on the body instance, so it carries over when the body is recreated
+void UContactDamageSubsystem::RegisterProjectile(UPrimitiveComponent* projectile, FOnProjectileBlockContact onContact)
+{
+	if(!projectile) return;
+	
+	projectile->BodyInstance.SetContactModification(true);
+	projectiles.Add(projectile, { projectile, MoveTemp(onContact) });
+}
+
+void UContactDamageSubsystem::UnregisterProjectile(UPrimitiveComponent* projectile)
+{
+	if(!projectile) return;
+	
+	projectile->BodyInstance.SetContactModification(false);
+	projectiles.Remove(projectile);
+}
+
+void UContactDamageSubsystem::RegisterBlock(ALevel0* level, UStaticMeshComponent* block)
+{
+	if(block) blocks.Add(block, { level, block });
+}
+
+void UContactDamageSubsystem::UnregisterBlock(UStaticMeshComponent* block)
+{
+	blocks.Remove(block);
+}
+
+bool UContactDamageSubsystem::DoesSupportWorldType(const EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ContactDamageBuffer.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ContactDamageSubsystem.generated.h"
+
+class ALevel0;
+class FContactDamageCallback;
+class UStaticMeshComponent;
+
+//Called on the game thread when a registered projectile has touched a level block
+DECLARE_DELEGATE_ThreeParams(FOnProjectileBlockContact, ALevel0* /*level*/, UStaticMeshComponent* /*block*/, const FVector& /*location*/);
+
+/**
+ * Resolves projectile against block contacts on the physics thread. A Chaos contact modification callback
+ * filters contact pairs by collision channel (see ARCollisionChannels.h) and records the projectile block pairs
+ * into an FContactDamageBuffer, the subsystem drains it once a frame and hands each contact to the projectile
+ * that registered for it. Registering a projectile turns on contact modification for its body, Chaos only
+ * passes pairs to the callback when one of the two bodies asks for it. Contacts are keyed by the owning
+ * component rather than the physics proxy, so a body recreated by a mobility change stays registered. Blocks then no longer need rigid body notifies, so block on block contacts never
+ * reach the game thread. Toggled with ar.PhysicsThreadDamage, read when projectiles and levels begin play.
+ */
+UCLASS()
+class UE5_AR_API UContactDamageSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static bool IsEnabled();
+
+	virtual void OnWorldBeginPlay(UWorld& inWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterProjectile(UPrimitiveComponent* projectile, FOnProjectileBlockContact onContact);
+	void UnregisterProjectile(UPrimitiveComponent* projectile);
+	void RegisterBlock(ALevel0* level, UStaticMeshComponent* block);
+	void UnregisterBlock(UStaticMeshComponent* block);
+
+	uint64 GetPairsFiltered() const { return callback ? buffer.GetPairsFiltered() : 0; }
+	uint64 GetContactEvents() const { return totalEvents; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type worldType) const override;
+
+private:
+	struct FRegisteredProjectile
+	{
+		TWeakObjectPtr<UPrimitiveComponent> component;
+		FOnProjectileBlockContact onContact;
+	};
+
+	struct FRegisteredBlock
+	{
+		TWeakObjectPtr<ALevel0> level;
+		TWeakObjectPtr<UStaticMeshComponent> component;
+	};
+
+	void ApplyContacts();
+
+	//Shared with the physics thread callback, which only ever pushes into it
+	FContactDamageBuffer buffer;
+	FContactDamageCallback* callback = nullptr;
+
+	TMap<const UObject*, FRegisteredProjectile> projectiles;
+	TMap<const UObject*, FRegisteredBlock> blocks;
+	TArray<FContactDamageEvent> drained;
+	TSet<TPair<const UObject*, const UObject*>> handledPairs;
+	uint64 totalEvents = 0;
+	uint64 lastPairsFiltered = 0;
+};
@@ -2,26 +2,113 @@
 
 
 #include "CustomGameMode.h"
+#include "ARGameplayAssets.h"
+#include "ARGameplaySettings.h"
+#include "ARStats.h"
 #include "ThePlayer.h"
 #include "Level0.h"
 #include "CustomGameState.h"
 #include "HelloARManager.h"
 #include "ARBlueprintLibrary.h"
 #include "BombProjectile.h"
+#include "DrawDebugHelpers.h"
+#include "ItemDrop.h"
+#include "GameplayActorPool.h"
+#include "ItemDropPool.h"
+#include "LevelLayoutData.h"
+#include "ProceduralTowerGenerator.h"
+#include "UIManager.h"
+#include "GameplayServicesSubsystem.h"
+#include "WidgetBase.h"
 #include "Projectile.h"
+#include "TouchTimestampProcessor.h"
+#include "Framework/Application/SlateApplication.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
 #include "HeadMountedDisplayFunctionLibrary.h"
+#include "VoiceModule.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 
-ACustomGameMode* ACustomGameMode::instance = nullptr;
+static TAutoConsoleVariable<int32> CVarShowTrajectory(
+	TEXT("ar.ShowTrajectory"), 0,
+	TEXT("1 draws the predicted flight of the dragged projectile, its landing point and the block it will hit."));
+
+static TAutoConsoleVariable<int32> CVarGeneratedTowerBlocks(
+	TEXT("ar.GeneratedTowerBlocks"), 0,
+	TEXT("Places a procedural tower of this many blocks instead of the selected level, 0 uses the hand-authored levels. Presets are 10, 100, 1000 and 10000."));
+
+static TAutoConsoleVariable<int32> CVarGeneratedTowerSeed(
+	TEXT("ar.GeneratedTowerSeed"), 0,
+	TEXT("Seed for the procedural tower, the same seed and block count always build the same tower."));
+
+static constexpr int32 TrajectoryPointCount = 32;
+static constexpr float TrajectoryMaxTime = 3.f;
+
+//Holds and throws several projectiles at once the way simultaneous touches do and logs what each launch costs
+static FAutoConsoleCommandWithWorldAndArgs ARMultiTouchThrowCommand(
+	TEXT("ar.Bench.MultiTouchThrow"),
+	TEXT("Spawns, drags and launches one projectile per finger with all fingers held at once. Usage: ar.Bench.MultiTouchThrow [touches, default 5]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(world);
+		ACustomGameMode* gameMode = services ? services->GetGameMode() : nullptr;
+		if(!gameMode) return;
+
+		const int32 touches = FMath::Clamp(args.Num() > 0 ? FCString::Atoi(*args[0]) : 5, 1, 10);
+		const FVector2D viewport(1080.f, 2340.f);
+
+		//Spread the fingers across the lower half of the screen and drag each one up
+		for(int32 finger = 0; finger < touches; finger++)
+		{
+			const FVector start(viewport.X * (finger + 1) / (touches + 1), viewport.Y * 0.8f, 0.f);
+			gameMode->SpawnProjectile(start, ProjectileType::Regular, finger);
+		}
+		for(int32 finger = 0; finger < touches; finger++)
+		{
+			const FVector drag(viewport.X * (finger + 1) / (touches + 1), viewport.Y * 0.6f, 0.f);
+			gameMode->MoveProjectile(drag, finger);
+		}
+
+		uint64 totalCycles = 0;
+		uint64 maxCycles = 0;
+		for(int32 finger = 0; finger < touches; finger++)
+		{
+			const FVector release(viewport.X * (finger + 1) / (touches + 1), viewport.Y * 0.5f, 0.f);
+			const uint64 startCycles = FPlatformTime::Cycles64();
+			gameMode->LaunchProjectile(release, release, 0.2f, finger);
+			const uint64 cycles = FPlatformTime::Cycles64() - startCycles;
+			
+			totalCycles += cycles;
+			maxCycles = FMath::Max(maxCycles, cycles);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Multi touch throw: %i launches, %.2f us average, %.2f us max"), touches,
+			FPlatformTime::ToMilliseconds64(totalCycles) * 1000.0 / touches, FPlatformTime::ToMilliseconds64(maxCycles) * 1000.0);
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ARLevelRestartCommand(
+	TEXT("ar.Bench.LevelRestart"),
+	TEXT("Spawns every tower in play fresh and restores it in place from its snapshot, logging both times. Usage: ar.Bench.LevelRestart [iterations, default 5]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(world);
+		if(ACustomGameMode* gameMode = services ? services->GetGameMode() : nullptr)
+		{
+			gameMode->BenchmarkLevelRestart(FMath::Max(args.Num() > 0 ? FCString::Atoi(*args[0]) : 5, 1));
+		}
+	}));
 
 ACustomGameMode::ACustomGameMode():
 	level(nullptr),
 	levelPlatform(nullptr),
-	regularProjectile(nullptr),
-	bombProjectile(nullptr)
+	HelloARManager(nullptr),
+	playerRef(nullptr),
+	itemDropPool(nullptr),
+	actorPool(nullptr),
+	uiManager(nullptr)
 {
 	// Add this line to your code if you wish to use the Tick() function
 	PrimaryActorTick.bCanEverTick = true;
+	bAsyncPhysicsTickEnabled = UARGameplaySettings::Get()->IsAsyncPhysicsEnabled();
 	
 	// Set the default pawn and gamestate to be our custom pawn and gamestate programatically
 	DefaultPawnClass = AThePlayer::StaticClass();
@@ -34,6 +121,10 @@ ACustomGameMode::ACustomGameMode():
 
 	static ConstructorHelpers::FObjectFinder<UClass>FoundLevel2(TEXT ("Class'/Game/Blueprints/Levels/BP_Level2.BP_Level2_C'"));
 	
+	//Win screen, built once at start play by the UI manager
+	static ConstructorHelpers::FObjectFinder<UClass>FoundWinScreen(TEXT ("Class'/Game/Blueprints/UI/WB_WinScreen.WB_WinScreen_C'"));
+	if(FoundWinScreen.Succeeded()) winScreenClass = FoundWinScreen.Object;
+	
 	//Platform
 	static ConstructorHelpers::FObjectFinder<UClass>FoundPlatform(TEXT ("Class'/Game/Blueprints/Levels/BP_Platform.BP_Platform_C'"));
 
@@ -45,19 +136,149 @@ ACustomGameMode::ACustomGameMode():
 	if(FoundLevel2.Succeeded()) levelInstance = FoundLevel2.Object;
 	levels.Add(levelInstance);
 	if(FoundPlatform.Succeeded()) levelPlatformInstance = FoundPlatform.Object; 
+
+	itemDropClass = AItemDrop::StaticClass();
 }
 
 
 void ACustomGameMode::StartPlay() 
 {
-	instance = this;
+	//Swap the device for a recorded session when one is passed on the command line
+	const FString playbackPath = FARSessionPlayback::GetCommandLinePath();
+	if(!playbackPath.IsEmpty())
+	{
+		sessionPlayback = MakeUnique<FARSessionPlayback>();
+		if(!sessionPlayback->LoadFromFile(playbackPath))
+		{
+			sessionPlayback.Reset();
+		}
+	}
+	
 	SpawnInitialActors();
+
+	//Register the gameplay services so actors can resolve them once at BeginPlay
+	UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+	services->RegisterGameMode(this);
+	services->RegisterARManager(HelloARManager);
+	services->RegisterPlayer(playerRef);
+
+	//Prewarm the item drops so destroyed blocks never spawn actors on the spot
+	{
+		TGuardValue<bool> prewarmGuard(prewarming, true);
+		itemDropPool = NewObject<UItemDropPool>(this);
+		itemDropPool->maxSpawnsPerFrame = maxItemDropsPerFrame;
+		itemDropPool->maxLiveDrops = maxLiveItemDrops;
+		itemDropPool->Initialise(GetWorld(), itemDropClass, itemDropPoolSize);
+	}
+
+	//Filled by PrewarmFirstUse once BeginPlay has been dispatched
+	actorPool = NewObject<UGameplayActorPool>(this);
+	actorPool->Initialise(GetWorld());
+
+	//Build every screen now so showing one mid game is only a visibility change
+	const double uiStartTime = FPlatformTime::Seconds();
+	uiManager = NewObject<UUIManager>(this);
+	uiManager->BuildScreen(GetWorld(), EGameScreen::Win, winScreenClass);
+	UE_LOG(LogTemp, Log, TEXT("UI manager: built screens in %.3f ms"), (FPlatformTime::Seconds() - uiStartTime) * 1000.0);
+
+	LoadBakedLayouts();
 	
 	// This is called before BeginPlay
 	StartPlayEvent();
 
 	// This function will transcend to call BeginPlay on all the actors 
 	Super::StartPlay();
+
+	//After BeginPlay has been dispatched so the warm up actors run theirs too
+	PrewarmFirstUse();
+	FARFrameStats::Get().BeginHitchReport(60.0);
+
+	if(!sessionPlayback && FSlateApplication::IsInitialized())
+	{
+		touchTimestamps = MakeShared<FTouchTimestampProcessor>();
+		FSlateApplication::Get().RegisterInputPreProcessor(touchTimestamps);
+	}
+}
+
+void ACustomGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(touchTimestamps.IsValid() && FSlateApplication::IsInitialized())
+	{
+		FSlateApplication::Get().UnregisterInputPreProcessor(touchTimestamps);
+	}
+	touchTimestamps.Reset();
+	
+	Super::EndPlay(EndPlayReason);
+}
+
+//Pays the one time costs of the first bomb, tic tac and win screen before play instead of as a hitch mid game
+void ACustomGameMode::PrewarmFirstUse()
+{
+	const double prewarmStartTime = FPlatformTime::Seconds();
+	TGuardValue<bool> prewarmGuard(prewarming, true);
+
+	//Opening the device is the expensive part, it stays open and only starts and stops after this
+	AcquireVoiceCapture();
+	ReleaseVoiceCapture();
+
+	//Parked in the pool, the launchers and levels take these instead of spawning
+	actorPool->Prewarm(AProjectile::StaticClass(), projectilePoolSize);
+	actorPool->Prewarm(ABombProjectile::StaticClass(), bombPoolSize);
+	actorPool->Prewarm(ATicTac::StaticClass(), ticTacPoolSize);
+
+	uiManager->PrewarmScreens();
+	UE_LOG(LogTemp, Log, TEXT("Prewarmed pooled actors, voice capture and screens in %.3f ms"), (FPlatformTime::Seconds() - prewarmStartTime) * 1000.0);
+}
+
+TSharedPtr<IVoiceCapture> ACustomGameMode::AcquireVoiceCapture()
+{
+	if(!voiceCapture.IsValid())
+	{
+		voiceCapture = FVoiceModule::Get().CreateVoiceCapture(TEXT(""), 44100, 1);
+	}
+	if(voiceCapture.IsValid() && voiceCaptureUsers++ == 0)
+	{
+		voiceCapture->Start();
+	}
+	return voiceCapture;
+}
+
+//Stopped between bombs so the next one does not read audio captured while no bomb was listening
+void ACustomGameMode::ReleaseVoiceCapture()
+{
+	if(voiceCaptureUsers > 0 && --voiceCaptureUsers == 0 && voiceCapture.IsValid())
+	{
+		voiceCapture->Stop();
+	}
+}
+
+//Loads the layout baked for each level class from UARGameplaySettings::bakedLayouts, a level without one
+//discovers its layout at runtime
+void ACustomGameMode::LoadBakedLayouts()
+{
+	const UARGameplaySettings* settings = UARGameplaySettings::Get();
+	FString unbakedLevels;
+	levelLayouts.Reset(levels.Num());
+	for(UClass* levelClass : levels)
+	{
+		ULevelLayoutData* layout = nullptr;
+		if(levelClass)
+		{
+			FString levelName = levelClass->GetName();
+			levelName.RemoveFromEnd(TEXT("_C"));
+			if(const TSoftObjectPtr<ULevelLayoutData>* bakedLayout = settings->bakedLayouts.Find(*levelName))
+			{
+				layout = bakedLayout->LoadSynchronous();
+			}
+			if(!layout) unbakedLevels += unbakedLevels.IsEmpty() ? levelName : TEXT(", ") + levelName;
+		}
+		levelLayouts.Add(layout);
+	}
+
+	if(!unbakedLevels.IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Baked layouts: none for %s, building those levels at runtime"), *unbakedLevels);
+	}
 }
 
 void ACustomGameMode::SetLevelIndex(int val)
@@ -75,11 +296,132 @@ void ACustomGameMode::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
+	if(sessionPlayback)
+	{
+		TickPlayback(DeltaSeconds);
+	}
+
+	if(itemDropPool)
+	{
+		itemDropPool->Tick();
+	}
+}
+
+//Physics thread in async physics mode, only touches the bodies through their physics thread handles
+void ACustomGameMode::AsyncPhysicsTickActor(float DeltaTime, float SimTime)
+{
+	Super::AsyncPhysicsTickActor(DeltaTime, SimTime);
+
+	FQueuedLaunch launch;
+	while(queuedLaunches.Dequeue(launch))
+	{
+		if(Chaos::FRigidBodyHandle_Internal* body = launch.proxy->GetPhysicsThreadAPI())
+		{
+			body->SetV(launch.velocity);
+		}
+	}
+}
+
+//Frame synced physics takes the velocity straight away, async physics applies it on a step boundary so the
+//launch lands on the same simulation step whatever the render frame rate
+void ACustomGameMode::ApplyLaunchVelocity(UPrimitiveComponent* projectileComp, const FVector& velocity)
+{
+	if(bAsyncPhysicsTickEnabled)
+	{
+		const FBodyInstance* body = projectileComp->GetBodyInstance();
+		if(Chaos::FSingleParticlePhysicsProxy* proxy = body ? body->GetPhysicsActorHandle() : nullptr)
+		{
+			queuedLaunches.Enqueue({ proxy, velocity });
+		}
+		return;
+	}
+	
+	projectileComp->SetPhysicsLinearVelocity(velocity);
+}
+
+void ACustomGameMode::TickPlayback(float DeltaSeconds)
+{
+	sessionPlayback->Advance(DeltaSeconds);
+	viewCache.Invalidate(); //The recorded camera just moved
+
+	//Drive the player from the recorded camera so aiming and line of sight match the capture
+	const FTransform& cameraTransform = sessionPlayback->GetCameraTransform();
+	if(playerRef)
+	{
+		playerRef->SetActorLocationAndRotation(cameraTransform.GetLocation(), cameraTransform.GetRotation());
+	}
+	if(APlayerController* playerController = GetPlayerController())
+	{
+		playerController->SetControlRotation(cameraTransform.Rotator());
+	}
+
+	FARRecordedTouch touch;
+	while(sessionPlayback->PopTouch(touch))
+	{
+		DispatchRecordedTouch(touch);
+	}
+
+	if(!playbackFinished && sessionPlayback->IsFinished())
+	{
+		playbackFinished = true;
+		UE_LOG(LogTemp, Log, TEXT("AR playback: finished after %.2f seconds"), sessionPlayback->GetPlaybackTime());
+	}
+}
+
+void ACustomGameMode::DispatchRecordedTouch(const FARRecordedTouch& touch)
+{
+	const FVector screenPos(touch.screenPos, 0.f);
+	recordedTouchTime = touch.time;
+	
+	switch(touch.action)
+	{
+	case EARRecordedTouchAction::Platform:
+		SpawnPlatform(screenPos);
+		break;
+		
+	case EARRecordedTouchAction::Level:
+		SpawnLevel(screenPos);
+		break;
+		
+	case EARRecordedTouchAction::Spawn:
+		playbackTouchStarts.Add(touch.fingerIndex, screenPos);
+		SpawnProjectile(screenPos, ProjectileType::Regular, touch.fingerIndex);
+		break;
+		
+	case EARRecordedTouchAction::SpawnBomb:
+		playbackTouchStarts.Add(touch.fingerIndex, screenPos);
+		SpawnProjectile(screenPos, ProjectileType::Bomb, touch.fingerIndex);
+		break;
+		
+	case EARRecordedTouchAction::Move:
+		MoveProjectile(screenPos, touch.fingerIndex);
+		break;
+		
+	case EARRecordedTouchAction::Launch:
+		MoveProjectile(screenPos, touch.fingerIndex);
+		LaunchProjectile(playbackTouchStarts.FindRef(touch.fingerIndex), screenPos, touch.holdTime, touch.fingerIndex);
+		playbackTouchStarts.Remove(touch.fingerIndex);
+		break;
+	}
+	
+	recordedTouchTime.Reset();
+}
+
+//Touch events arrive at input rate and several can land in one frame, so each sample takes the time its event
+//reached Slate rather than the time it is handled. Recorded touches keep their capture time
+double ACustomGameMode::GetTouchSampleTime(int32 fingerIndex)
+{
+	if(recordedTouchTime.IsSet()) return recordedTouchTime.GetValue();
+
+	double eventTime;
+	if(touchTimestamps.IsValid() && touchTimestamps->PopTimestamp(fingerIndex, eventTime)) return eventTime;
+	return FPlatformTime::Seconds();
 }
 
 void ACustomGameMode::SpawnInitialActors()
 {
-	if(HelloARManager) return;
+	//No AR session is needed when a recording is driving the game
+	if(HelloARManager || sessionPlayback) return;
 	
 	// Spawn an instance of the HelloARManager class
 	FVector Pos(0,0,0);
@@ -92,120 +434,130 @@ void ACustomGameMode::SpawnInitialActors()
 }
 
 /*This function will spawn a projectile where the player presses on the screen*/
-void ACustomGameMode::SpawnProjectile(FVector screenPos, ProjectileType projectileType)
+void ACustomGameMode::SpawnProjectile(FVector screenPos, ProjectileType projectileType, int32 fingerIndex)
 {
-	const APlayerController* playerController = GetPlayerController();
 	FVector worldPos, worldDir;
 
 	//Deproject screen position to world space
-	UGameplayStatics::DeprojectScreenToWorld(playerController, FVector2D(screenPos), worldPos, worldDir);
+	DeprojectScreen(screenPos, worldPos, worldDir);
 
 	//Set the distance in front of the camera for spawning the projectile
 	projectileDistanceOffset = 100.f;
 	FVector spawnLocation = worldPos + projectileDistanceOffset * worldDir;
-	const FActorSpawnParameters spawnInfo;
-	const FRotator rotation(0,0,0);
+	const double sampleTime = GetTouchSampleTime(fingerIndex);
 	
 	switch(projectileType)
 	{
 	case ProjectileType::Regular:
-		regularProjectile = GetWorld()->SpawnActor<AProjectile>(spawnLocation, rotation, spawnInfo);
+		regularLauncher.Spawn(GetWorld(), actorPool, fingerIndex, spawnLocation, sampleTime);
 		break;
 		
 	case ProjectileType::Bomb:
 		// GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Cyan, (TEXT("We be bomb!!")));
-		bombProjectile = GetWorld()->SpawnActor<ABombProjectile>(spawnLocation, rotation, spawnInfo);
+		bombLauncher.Spawn(GetWorld(), actorPool, fingerIndex, spawnLocation, sampleTime);
 		playerRef->SetProjectileType(ProjectileType::Regular);
 	}
 }
 
-void ACustomGameMode::MoveProjectile(FVector screenPos)
+void ACustomGameMode::MoveProjectile(FVector screenPos, int32 fingerIndex)
 {
+	AR_SCOPED_STAT(MoveProjectile);
 	FVector worldPos, worldDir;
-	const APlayerController* playerController = GetPlayerController();
 
 	//Deproject to world space
-	UGameplayStatics::DeprojectScreenToWorld(playerController, FVector2D(screenPos), worldPos, worldDir);
-	
-	if(regularProjectile && regularProjectile->IsValidLowLevel())
+	DeprojectScreen(screenPos, worldPos, worldDir);
+
+	//Set the new location of the projectile held by this finger
+	const FVector newPos = worldPos + projectileDistanceOffset * worldDir;
+	const double sampleTime = GetTouchSampleTime(fingerIndex);
+	regularLauncher.Move(fingerIndex, newPos, sampleTime);
+	bombLauncher.Move(fingerIndex, newPos, sampleTime);
+	UpdateTrajectoryPreview(fingerIndex, sampleTime);
+}
+
+//Solves where the dragged projectile would go if it were released now and samples the arc for drawing
+void ACustomGameMode::UpdateTrajectoryPreview(int32 fingerIndex, double time)
+{
+	AR_SCOPED_STAT(TrajectoryPreview);
+	FVector start, velocity;
+	float radius;
+	if(!regularLauncher.PreviewLaunch(fingerIndex, time, start, velocity, radius) && !bombLauncher.PreviewLaunch(fingerIndex, time, start, velocity, radius))
 	{
-		//Set the new location of the player projectile
-		FVector newPos = worldPos + projectileDistanceOffset * worldDir;
-		regularProjectile->SetActorLocation(newPos);
+		return;
 	}
 
-	if(bombProjectile && bombProjectile->IsValidLowLevel())
+	//The path is the projectile's centre, so every box is grown by its radius to catch glancing hits
+	const FBallisticPath path(start, velocity, GetWorld()->GetGravityZ());
+	blockBoundsScratch.Reset();
+	blockScratch.Reset();
+	for(const FPlacedTower& tower : towers)
 	{
-		//Set the new location of the player projectile
-		FVector newPos = worldPos + projectileDistanceOffset * worldDir;
-		bombProjectile->SetActorLocation(newPos);
+		if(tower.level) tower.level->GatherBlockBounds(blockBoundsScratch, blockScratch, radius);
 	}
+
+	//Nothing below the platform's top can be hit, without one the arc just runs for the full preview time
+	TOptional<float> groundHeight;
+	if(levelPlatform) groundHeight = levelPlatform->GetComponentsBoundingBox().Max.Z + radius;
+	trajectoryPrediction = BallisticSolver::Predict(path, blockBoundsScratch, groundHeight, TrajectoryMaxTime);
+	predictedBlock = blockScratch.IsValidIndex(trajectoryPrediction.hitIndex) ? blockScratch[trajectoryPrediction.hitIndex] : nullptr;
+	path.Sample(trajectoryPrediction.landingTime, TrajectoryPointCount, trajectoryPoints);
+
+#if ENABLE_DRAW_DEBUG
+	if(CVarShowTrajectory.GetValueOnGameThread() != 0)
+	{
+		for(int32 index = 1; index < trajectoryPoints.Num(); index++)
+		{
+			DrawDebugLine(GetWorld(), trajectoryPoints[index - 1], trajectoryPoints[index], FColor::Cyan);
+		}
+		DrawDebugSphere(GetWorld(), trajectoryPrediction.landingPoint, 3.f, 8, trajectoryPrediction.landed ? FColor::Green : FColor::Red);
+		if(blockBoundsScratch.IsValidIndex(trajectoryPrediction.hitIndex))
+		{
+			const FBox& hitBox = blockBoundsScratch[trajectoryPrediction.hitIndex];
+			DrawDebugBox(GetWorld(), hitBox.GetCenter(), hitBox.GetExtent(), FColor::Orange);
+		}
+	}
+#endif
 }
 
 /*This function deals with launching the projectile when the player lets go
  * of the screen
  */
-void ACustomGameMode::LaunchProjectile(const FVector& startPos, const FVector& endPos, float touchTime)
+void ACustomGameMode::LaunchProjectile(const FVector& startPos, const FVector& endPos, float touchTime, int32 fingerIndex)
 {
+	AR_SCOPED_STAT(LaunchProjectile);
 	//Cap the touchTime so player cannot infinitely increase the speed
 	if(touchTime > 0.5f) touchTime = 0.5f;
-	if (regularProjectile && regularProjectile->IsValidLowLevel())
-	{
-		//Set the projectile physics to enabled
-		regularProjectile->SetPhysicsSimulation(true);
-
-		//Set a new gravitational force for moving the object down
-		FVector newGravity = FVector(0.f,0.f,-2.8f);
-		
-		//Clamp the velocity of the player projectile forward and right motion (X,Y)
-		FVector velocityScale = FVector(1.75f,1.75f,0.5f);
-		FVector currentVel = regularProjectile->GetStaticMeshComponent()->GetComponentVelocity();
-		FVector velocity = currentVel * velocityScale;
-
-		velocity.Z = FMath::Clamp(velocity.Z, 0, 150.f);
-		velocity.Y = FMath::Clamp(velocity.Y, -500.f, 500.f);
-		velocity.X = FMath::Clamp(velocity.X, -500.f, 500.f);
 
-		regularProjectile->GetStaticMeshComponent()->SetPhysicsLinearVelocity(velocity);
-		regularProjectile->SetPlayerProjectile(true); //Set this so player score increments
-	}
-
-	if(bombProjectile && bombProjectile->IsValidLowLevel())
+	auto applyVelocity = [this](UPrimitiveComponent* projectileComp, const FVector& velocity)
 	{
-		//Set the projectile physics to enabled
-		bombProjectile->SetPhysicsSimulation(true);
-
-		//Set a new gravitational force for moving the object down
-		FVector newGravity = FVector(0.f,0.f,-2.8f);
-		
-		//Clamp the velocity of the player projectile forward and right motion (X,Y)
-		FVector velocityScale = FVector(1.75f,1.75f,0.5f);
-		FVector currentVel = bombProjectile->GetStaticMeshComponent()->GetComponentVelocity();
-		FVector velocity = currentVel * velocityScale;
-
-		velocity.Z = FMath::Clamp(velocity.Z, 0, 150.f);
-		velocity.Y = FMath::Clamp(velocity.Y, -500.f, 500.f);
-		velocity.X = FMath::Clamp(velocity.X, -500.f, 500.f);
-
-		bombProjectile->GetStaticMeshComponent()->SetPhysicsLinearVelocity(velocity);
-		bombProjectile->SetPlayerProjectile(true); //Set this so player score increments
-	}
+		ApplyLaunchVelocity(projectileComp, velocity);
+	};
+	//The release velocity is fitted over the drag samples up to now, not read back from last frame's teleport
+	const double releaseTime = GetTouchSampleTime(fingerIndex);
+	regularLauncher.Launch(fingerIndex, releaseTime, applyVelocity);
+	bombLauncher.Launch(fingerIndex, releaseTime, applyVelocity);
+	if(touchTimestamps.IsValid()) touchTimestamps->ResetFinger(fingerIndex);
+
+	//The preview belongs to the drag, Reset keeps the buffer for the next one
+	trajectoryPoints.Reset();
+	trajectoryPrediction = FBallisticPrediction();
+	predictedBlock = nullptr;
 }
 
 //This will be the function where the player places the level on a plane
 void ACustomGameMode::SpawnLevel(FVector screenPos)
 {
-	if(HelloARManager->GetPausePlanes()) return;
-	const TOptional<FARTraceResult> traceResult = LineTrace(screenPos);
+	if(HelloARManager && HelloARManager->GetPausePlanes()) return;
+	FTransform trackedTF;
+	UARTrackedGeometry* trackedGeometry = nullptr;
 
 	//If the placing of the level is not on a valid plane then return
-	if(!traceResult.IsSet()) return;
-	HelloARManager->EnablePlaneUpdate(true);
+	if(!TracePlacement(screenPos, trackedTF, trackedGeometry)) return;
+	if(HelloARManager) HelloARManager->EnablePlaneUpdate(true);
 	playerRef->SetLevelSpawned(true);
 	playerRef->EnableThrow(true);	//Player can throw now
 	
 	bool continueHere;
-	const FTransform trackedTF = traceResult.GetValue().GetLocalToWorldTransform();
 
 	if(levelInstance)
 	{
@@ -217,6 +569,15 @@ void ACustomGameMode::SpawnLevel(FVector screenPos)
 	}
 
 	if(!continueHere) return;
+
+	//Tapping a plane near a tower moves that tower, elsewhere a new tower goes up until the tower limit is reached
+	ALevel0* placedTower = FindTowerNear(trackedTF.GetLocation());
+	if(!placedTower && towers.Num() >= FMath::Max(UARGameplaySettings::Get()->maxTowers, 1))
+	{
+		placedTower = level;
+	}
+	level = placedTower;
+	
 	// Logic for both ARPin and non-ARPin cases
 	if (!level)
 	{
@@ -225,30 +586,132 @@ void ACustomGameMode::SpawnLevel(FVector screenPos)
 		FVector MyLoc = trackedTF.GetTranslation();
 		MyLoc.Z = levelPlatform->GetActorLocation().Z + (levelPlatform->GetActorScale3D().Z) * 10.f; 
 		
-		level = GetWorld()->SpawnActor<ALevel0>(levels[levelIndex], MyLoc, MyRot);
-		FVector scale = FVector(0.15f, 0.15f, 0.15f);
-		level->SetObjectMobility(EComponentMobility::Movable);
-		level->SetObjectScale(scale);
-		level->SpawnTicTacs();
-		level->SetPhysicsSimulation(true);
+		//A level finished before is restored in place, only a level never played is built from its blueprint
+		const double spawnStartTime = FPlatformTime::Seconds();
+		ALevel0* retiredLevel = nullptr;
+		for(auto retired = retiredLevels.CreateKeyIterator(levelIndex); retired && !retiredLevel; ++retired)
+		{
+			retiredLevel = retired.Value().Get();
+			retired.RemoveCurrent();
+		}
+		if(retiredLevel && retiredLevel->HasSnapshot())
+		{
+			level = retiredLevel;
+			level->SetActorTransform(FTransform(MyRot, MyLoc));
+			level->RestoreSnapshot();
+			level->SetLevelActive(true);
+			UE_LOG(LogTemp, Log, TEXT("Level %i restarted in %.3f ms"), levelIndex, (FPlatformTime::Seconds() - spawnStartTime) * 1000.0);
+		}
+		else
+		{
+			level = SpawnLevelActor(levelIndex, FTransform(MyRot, MyLoc));
+			UE_LOG(LogTemp, Log, TEXT("Level %i spawned in %.3f ms"), levelIndex, (FPlatformTime::Seconds() - spawnStartTime) * 1000.0);
+		}
+		towers.Add({ level, levelIndex });
 	}
 
 	// Set the spawned actor location based on the Pin.
 	level->SetActorTransform(trackedTF);
-	level->PinComponent = UARBlueprintLibrary::PinComponent(nullptr, trackedTF, traceResult.GetValue().GetTrackedGeometry());
+	if(!sessionPlayback)
+	{
+		level->PinComponent = UARBlueprintLibrary::PinComponent(nullptr, trackedTF, trackedGeometry);
+	}
+}
+
+ALevel0* ACustomGameMode::SpawnLevelActor(int32 index, const FTransform& spawnTF)
+{
+	//Deferred so the level has its baked layout before BeginPlay runs
+	ALevel0* newLevel;
+	const int32 generatedBlocks = CVarGeneratedTowerBlocks.GetValueOnGameThread();
+	UStaticMesh* blockMesh = generatedBlocks > 0 ? FARGameplayAssets::Get().generatedBlockMesh : nullptr;
+	if(blockMesh)
+	{
+		newLevel = GetWorld()->SpawnActorDeferred<ALevel0>(ALevel0::StaticClass(), spawnTF);
+		newLevel->SetGeneratedLayout(GetGeneratedLayout(generatedBlocks, CVarGeneratedTowerSeed.GetValueOnGameThread()), blockMesh);
+	}
+	else
+	{
+		newLevel = GetWorld()->SpawnActorDeferred<ALevel0>(levels[index], spawnTF);
+		newLevel->SetBakedLayout(levelLayouts.IsValidIndex(index) ? levelLayouts[index] : nullptr);
+	}
+	newLevel->FinishSpawning(spawnTF);
+	
+	FVector scale = FVector(0.15f, 0.15f, 0.15f);
+	newLevel->SetObjectMobility(EComponentMobility::Movable);
+	newLevel->SetObjectScale(scale);
+	newLevel->SpawnTicTacs();
+	newLevel->EnableLazyPhysics();
+	newLevel->CaptureSnapshot();
+	return newLevel;
+}
+
+ULevelLayoutData* ACustomGameMode::GetGeneratedLayout(int32 blockCount, int32 seed)
+{
+	const FIntPoint key(blockCount, seed);
+	if(ULevelLayoutData* const* existing = generatedLayouts.Find(key)) return *existing;
+
+	const double generateStartTime = FPlatformTime::Seconds();
+	FProceduralTowerParams params;
+	params.targetBlocks = blockCount;
+	params.seed = seed;
+	
+	ULevelLayoutData* layout = NewObject<ULevelLayoutData>(this);
+	ProceduralTowerGenerator::Generate(params, layout);
+	generatedLayouts.Add(key, layout);
+	
+	UE_LOG(LogTemp, Log, TEXT("Generated a %i block tower (seed %i) with %i turrets in %.3f ms"), blockCount, seed,
+		layout->turretTransforms.Num(), (FPlatformTime::Seconds() - generateStartTime) * 1000.0);
+	return layout;
+}
+
+//Towers are a few blocks wide once scaled, a placement within this distance of one is taken as moving it
+ALevel0* ACustomGameMode::FindTowerNear(const FVector& location) const
+{
+	static constexpr float TowerPlacementRadius = 30.f;
+	for(const FPlacedTower& tower : towers)
+	{
+		if(FVector::DistSquared2D(tower.level->GetActorLocation(), location) < FMath::Square(TowerPlacementRadius))
+		{
+			return tower.level;
+		}
+	}
+	return nullptr;
+}
+
+int32 ACustomGameMode::GetTowerLevelIndex(const ALevel0* tower) const
+{
+	const FPlacedTower* placed = towers.FindByPredicate([tower](const FPlacedTower& entry) { return entry.level == tower; });
+	return placed ? placed->levelIndex : INDEX_NONE;
+}
+
+//Benchmark towers, copies of the current tower spaced out in a ring around it
+void ACustomGameMode::SpawnExtraTowers(int32 count)
+{
+	const int32 index = GetTowerLevelIndex(level);
+	if(!level || !levels.IsValidIndex(index) || count <= 0) return;
+
+	const FVector centre = level->GetActorLocation();
+	const float spacing = FMath::Max(level->GetComponentsBoundingBox().GetSize().Size2D() * 1.5f, 50.f);
+	for(int32 tower = 0; tower < count; tower++)
+	{
+		const float angle = 2.f * PI * tower / count;
+		const FTransform spawnTF(level->GetActorRotation(), centre + FVector(FMath::Cos(angle), FMath::Sin(angle), 0.f) * spacing);
+		towers.Add({ SpawnLevelActor(index, spawnTF), index });
+	}
+	UE_LOG(LogTemp, Log, TEXT("Spawned %i extra towers, %i in play"), count, towers.Num());
 }
 
 void ACustomGameMode::SpawnPlatform(FVector screenPos)
 {
-	if(HelloARManager->GetPausePlanes()) return;
-	const TOptional<FARTraceResult> traceResult = LineTrace(screenPos);
+	if(HelloARManager && HelloARManager->GetPausePlanes()) return;
+	FTransform trackedTF;
+	UARTrackedGeometry* trackedGeometry = nullptr;
 
 	//If the placing of the level is not on a valid plane then return
-	if(!traceResult.IsSet()) return;
+	if(!TracePlacement(screenPos, trackedTF, trackedGeometry)) return;
 	playerRef->SetPlatformSpawned(true);
 	
 	bool continueHere;
-	const FTransform trackedTF = traceResult.GetValue().GetLocalToWorldTransform();
 	
 	if(levelPlatformInstance)
 	{
@@ -273,21 +736,67 @@ void ACustomGameMode::SpawnPlatform(FVector screenPos)
 		levelPlatform->SetObjectScale(scale);
 		levelPlatform->SetPhysicsSimulation(false);
 
-		HelloARManager->SetPlaneColourTransparent();
+		if(HelloARManager) HelloARManager->SetPlaneColourTransparent();
 	}
 
 	// Set the spawned actor location based on the Pin.
 	levelPlatform->SetActorTransform(trackedTF);
-	levelPlatform->PinComponent = UARBlueprintLibrary::PinComponent(nullptr, trackedTF, traceResult.GetValue().GetTrackedGeometry());
+	if(!sessionPlayback)
+	{
+		levelPlatform->PinComponent = UARBlueprintLibrary::PinComponent(nullptr, trackedTF, trackedGeometry);
+	}
 }
 
-TOptional<FARTraceResult> ACustomGameMode::LineTrace(FVector screenPos)
+//Filled on the first screen-space query of a frame, from the recorded camera during playback, otherwise from the
+//player's viewport
+const FARViewCache& ACustomGameMode::GetViewCache()
 {
-	const APlayerController* playerController = GetPlayerController();
-	FVector worldPos;
-	FVector worldDir;
+	if(!viewCache.IsCurrent())
+	{
+		if(sessionPlayback)
+		{
+			viewCache.UpdateFromCamera(sessionPlayback->GetCameraTransform(), sessionPlayback->GetFieldOfView(), sessionPlayback->GetViewportSize());
+		}
+		else
+		{
+			viewCache.UpdateFromPlayer(GetPlayerController());
+		}
+	}
+	return viewCache;
+}
+
+bool ACustomGameMode::DeprojectScreen(const FVector& screenPos, FVector& worldPos, FVector& worldDir)
+{
+	AR_SCOPED_STAT(Deproject);
+	return GetViewCache().Deproject(FVector2D(screenPos), worldPos, worldDir);
+}
+
+bool ACustomGameMode::DeprojectScreenBatch(TArrayView<const FVector2D> screenPositions, TArrayView<FVector> outWorldPos, TArrayView<FVector> outWorldDir)
+{
+	AR_SCOPED_STAT(Deproject);
+	return GetViewCache().DeprojectBatch(screenPositions, outWorldPos, outWorldDir);
+}
+
+//Finds where a touch lands on a tracked plane, either from the AR system or from the recorded planes
+bool ACustomGameMode::TracePlacement(const FVector& screenPos, FTransform& outTransform, UARTrackedGeometry*& outGeometry)
+{
+	outGeometry = nullptr;
+	if(sessionPlayback)
+	{
+		FVector worldPos, worldDir;
+		return DeprojectScreen(screenPos, worldPos, worldDir) && sessionPlayback->LineTracePlanes(worldPos, worldDir, outTransform);
+	}
+
+	const TOptional<FARTraceResult> traceResult = LineTrace(screenPos);
+	if(!traceResult.IsSet()) return false;
+	
+	outTransform = traceResult.GetValue().GetLocalToWorldTransform();
+	outGeometry = traceResult.GetValue().GetTrackedGeometry();
+	return true;
+}
 
-	UGameplayStatics::DeprojectScreenToWorld(playerController, FVector2D(screenPos), worldPos, worldDir);
+TOptional<FARTraceResult> ACustomGameMode::LineTrace(FVector screenPos)
+{
 	auto traceResult = UARBlueprintLibrary::LineTraceTrackedObjects(FVector2D(screenPos), false, false, false, true);
 	
 	if (traceResult.IsValidIndex(0))
@@ -306,24 +815,78 @@ TOptional<FARTraceResult> ACustomGameMode::LineTrace(FVector screenPos)
 void ACustomGameMode::SetPlayerReference(AThePlayer* pRef)
 {
 	playerRef = pRef;
+	if(UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this))
+	{
+		services->RegisterPlayer(pRef);
+	}
 }
 
-void ACustomGameMode::ResetLevel()
+//The finished tower stays in the world, parked, so playing it again is a restore rather than a respawn
+void ACustomGameMode::ResetLevel(ALevel0* finishedLevel)
 {
-	level = nullptr;
+	const int32 index = GetTowerLevelIndex(finishedLevel);
+	if(index != INDEX_NONE)
+	{
+		retiredLevels.Add(index, finishedLevel);
+	}
+	towers.RemoveAll([finishedLevel](const FPlacedTower& tower) { return tower.level == finishedLevel; });
+
+	//The most recently placed tower still standing becomes the one taps move
+	if(level == finishedLevel)
+	{
+		level = towers.Num() > 0 ? towers.Last().level : nullptr;
+	}
+}
+
+void ACustomGameMode::BenchmarkLevelRestart(int32 iterations)
+{
+	double spawnMs = 0.0;
+	double restoreMs = 0.0;
+	int32 benchmarkedTowers = 0;
+	
+	for(const FPlacedTower& tower : towers)
+	{
+		if(!tower.level || !tower.level->HasSnapshot() || !levels.IsValidIndex(tower.levelIndex)) continue;
+		benchmarkedTowers++;
+
+		//Fresh copies go well away from the tower being played so they never touch it
+		const FTransform spawnTF(tower.level->GetActorRotation(), tower.level->GetActorLocation() + FVector(0.f, 0.f, 100000.f));
+		for(int32 iteration = 0; iteration < iterations; iteration++)
+		{
+			double startTime = FPlatformTime::Seconds();
+			ALevel0* freshLevel = SpawnLevelActor(tower.levelIndex, spawnTF);
+			spawnMs += (FPlatformTime::Seconds() - startTime) * 1000.0;
+			freshLevel->Destroy();
+
+			startTime = FPlatformTime::Seconds();
+			tower.level->RestoreSnapshot();
+			restoreMs += (FPlatformTime::Seconds() - startTime) * 1000.0;
+		}
+	}
+
+	if(benchmarkedTowers == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Level restart benchmark: needs a level that has been spawned"));
+		return;
+	}
+
+	const int32 restarts = benchmarkedTowers * iterations;
+	UE_LOG(LogTemp, Display, TEXT("Level restart benchmark, %i towers over %i iterations: fresh spawn %.3f ms, restore %.3f ms per tower"),
+		benchmarkedTowers, iterations, spawnMs / restarts, restoreMs / restarts);
 }
 
 void ACustomGameMode::PauseARManager(bool val)
 {
 	//HelloARManager->PauseSession(val);
-	HelloARManager->EnablePlaneUpdate(val);
+	if(HelloARManager) HelloARManager->EnablePlaneUpdate(val);
 }
 
 
 //Getters
 ACustomGameMode* ACustomGameMode::GetCustomGameModeRef()
 {
-	return instance;
+	const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+	return services ? services->GetGameMode() : nullptr;
 }
 
 APlayerController* ACustomGameMode::GetPlayerController()
@@ -334,6 +897,11 @@ APlayerController* ACustomGameMode::GetPlayerController()
 FRotator ACustomGameMode::GetDeviceRotation()
 {
 	FRotator rotator;
+	if(sessionPlayback)
+	{
+		return sessionPlayback->GetDeviceRotation();
+	}
+	
 	if(UHeadMountedDisplayFunctionLibrary::IsHeadMountedDisplayEnabled())
 	{
 		//Get the HMD orientation (gyroscopic features)
@@ -356,6 +924,36 @@ AHelloARManager* ACustomGameMode::GetHelloARManager()
 	return HelloARManager;
 }
 
+ALevel0* ACustomGameMode::GetLevel()
+{
+	return level;
+}
+
+UItemDropPool* ACustomGameMode::GetItemDropPool()
+{
+	return itemDropPool;
+}
+
+UGameplayActorPool* ACustomGameMode::GetActorPool()
+{
+	return actorPool;
+}
+
+UUIManager* ACustomGameMode::GetUIManager()
+{
+	return uiManager;
+}
+
+bool ACustomGameMode::IsPlaybackActive() const
+{
+	return sessionPlayback.IsValid();
+}
+
+bool ACustomGameMode::IsPlaybackFinished() const
+{
+	return playbackFinished;
+}
+
 
 
 
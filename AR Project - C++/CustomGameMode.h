@@ -3,8 +3,13 @@
 #pragma once
 
 #include "ARTraceResult.h"
+#include "ARSessionPlayback.h"
 #include "HelloARManager.h"
 #include "Projectile.h"
+#include "ARViewCache.h"
+#include "BallisticSolver.h"
+#include "ProjectileLauncher.h"
+#include "Containers/Queue.h"
 #include "GameFramework/GameModeBase.h"
 #include "CustomGameMode.generated.h"
 
@@ -13,7 +18,17 @@ class APlaceableActor;
 class AThePlayer;
 class AProjectile;
 class ABombProjectile;
+class IVoiceCapture;
 class ALevel0;
+class ULevelLayoutData;
+class AItemDrop;
+class UItemDropPool;
+class UGameplayActorPool;
+class UUIManager;
+class UWidgetBase;
+class UARTrackedGeometry;
+class FTouchTimestampProcessor;
+namespace Chaos { class FSingleParticlePhysicsProxy; }
 
 
 UCLASS()
@@ -27,6 +42,7 @@ public:
 	
 	ACustomGameMode* GetCustomGameModeRef();
 	virtual void StartPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION(BlueprintCallable, Category = "GameModeBase")
 	void SetLevelIndex(int val);
@@ -39,16 +55,46 @@ public:
 	
 	 UPROPERTY(Category="Placeable",EditAnywhere,BlueprintReadWrite)
 	 TSubclassOf<APlaceableActor> PlaceableToSpawn;
+
+	UPROPERTY(Category = "UI", EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<UWidgetBase> winScreenClass;
+
+	UPROPERTY(Category = "Item Drops", EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<AItemDrop> itemDropClass;
+
+	UPROPERTY(Category = "Item Drops", EditAnywhere, BlueprintReadWrite)
+	int itemDropPoolSize = 8;
+
+	UPROPERTY(Category = "Item Drops", EditAnywhere, BlueprintReadWrite)
+	int maxItemDropsPerFrame = 2;
+
+	UPROPERTY(Category = "Item Drops", EditAnywhere, BlueprintReadWrite)
+	int maxLiveItemDrops = 12;
+
+	UPROPERTY(Category = "Actor Pool", EditAnywhere, BlueprintReadWrite)
+	int projectilePoolSize = 5;
+
+	UPROPERTY(Category = "Actor Pool", EditAnywhere, BlueprintReadWrite)
+	int bombPoolSize = 2;
+
+	UPROPERTY(Category = "Actor Pool", EditAnywhere, BlueprintReadWrite)
+	int ticTacPoolSize = 16;
 	
 	virtual void Tick(float DeltaSeconds) override;
+	virtual void AsyncPhysicsTickActor(float DeltaTime, float SimTime) override;
 	virtual void SpawnInitialActors();
 	
 	virtual void SpawnLevel(FVector screenPos);
-	virtual void SpawnProjectile(FVector screenPos, ProjectileType projectileType);
+	virtual void SpawnProjectile(FVector screenPos, ProjectileType projectileType, int32 fingerIndex = 0);
 	virtual void SpawnPlatform(FVector screenPos);
 	
-	virtual void MoveProjectile(FVector screenPos);
-	void LaunchProjectile(const FVector& startPos, const FVector& endPos, float touchTime);
+	virtual void MoveProjectile(FVector screenPos, int32 fingerIndex = 0);
+	void LaunchProjectile(const FVector& startPos, const FVector& endPos, float touchTime, int32 fingerIndex = 0);
+
+	//Predicted flight of the projectile last dragged, refreshed on every drag sample
+	const TArray<FVector>& GetTrajectoryPoints() const { return trajectoryPoints; }
+	const FBallisticPrediction& GetTrajectoryPrediction() const { return trajectoryPrediction; }
+	UStaticMeshComponent* GetPredictedBlock() const { return predictedBlock.Get(); }
 	
 	virtual TOptional<FARTraceResult> LineTrace(FVector screenPos);
 	
@@ -57,24 +103,119 @@ public:
 	FRotator GetDeviceRotation();
 	APlayerController* GetPlayerController();
 	AHelloARManager* GetHelloARManager();
-	void ResetLevel();
+	ALevel0* GetLevel();
+	UItemDropPool* GetItemDropPool();
+	UGameplayActorPool* GetActorPool();
+
+	//True while start play fills the pools, those spawns are not gameplay
+	bool IsPrewarming() const { return prewarming; }
+	UFUNCTION(BlueprintCallable, Category = "GameModeBase")
+	UUIManager* GetUIManager();
+	bool IsPlaybackActive() const;
+	bool IsPlaybackFinished() const;
+	void ResetLevel(ALevel0* finishedLevel);
+	int32 GetNumTowers() const { return towers.Num(); }
+	void SpawnExtraTowers(int32 count);
+
+	//One capture device for the whole session, opened in the prewarm and started only while a bomb holds it
+	TSharedPtr<IVoiceCapture> AcquireVoiceCapture();
+	void ReleaseVoiceCapture();
+
+	//Times building every tower in play from its blueprint against restoring it from its snapshot
+	void BenchmarkLevelRestart(int32 iterations);
 
 private:
+	const FARViewCache& GetViewCache();
+	bool DeprojectScreen(const FVector& screenPos, FVector& worldPos, FVector& worldDir);
+	bool DeprojectScreenBatch(TArrayView<const FVector2D> screenPositions, TArrayView<FVector> outWorldPos, TArrayView<FVector> outWorldDir);
+	bool TracePlacement(const FVector& screenPos, FTransform& outTransform, UARTrackedGeometry*& outGeometry);
+	void TickPlayback(float DeltaSeconds);
+	void DispatchRecordedTouch(const FARRecordedTouch& touch);
+	double GetTouchSampleTime(int32 fingerIndex);
+	void LoadBakedLayouts();
+	void PrewarmFirstUse();
+	ALevel0* SpawnLevelActor(int32 index, const FTransform& spawnTF);
+	ALevel0* FindTowerNear(const FVector& location) const;
+	ULevelLayoutData* GetGeneratedLayout(int32 blockCount, int32 seed);
+	int32 GetTowerLevelIndex(const ALevel0* tower) const;
+	void ApplyLaunchVelocity(UPrimitiveComponent* projectileComp, const FVector& velocity);
+	void UpdateTrajectoryPreview(int32 fingerIndex, double time);
+
 	FTimerHandle Ticker;
 	float projectileDistanceOffset = 100.f;
 
-	ALevel0* level;
+	//Camera and inverse view-projection for the current frame, shared by every screen-space query
+	FARViewCache viewCache;
+
+	//Trajectory preview, the buffers are reused so dragging does not allocate once they have grown
+	TArray<FVector> trajectoryPoints;
+	TArray<FBox> blockBoundsScratch;
+	TArray<UStaticMeshComponent*> blockScratch;
+	FBallisticPrediction trajectoryPrediction;
+	TWeakObjectPtr<UStaticMeshComponent> predictedBlock;
+
+	ALevel0* level; //The tower placed or moved last, taps on the same spot move it
 	ALevel0* levelPlatform;
+
+	//Every tower in play with the entry of levels it was built from, up to UARGameplaySettings::maxTowers
+	struct FPlacedTower
+	{
+		ALevel0* level;
+		int32 levelIndex;
+	};
+	TArray<FPlacedTower> towers;
+
+	//Finished towers by level index, hidden until the same level is picked again
+	TMultiMap<int32, TWeakObjectPtr<ALevel0>> retiredLevels;
 	TArray<UClass*>levels;
-	AProjectile* regularProjectile;
+
+	//Baked layout for each entry in levels, null where the level has not been baked
+	UPROPERTY()
+	TArray<ULevelLayoutData*> levelLayouts;
+
+	//Procedural tower layouts by block count and seed, generated on first use and shared by every tower built from them
+	UPROPERTY()
+	TMap<FIntPoint, ULevelLayoutData*> generatedLayouts;
 	AHelloARManager* HelloARManager;
-	ABombProjectile* bombProjectile;
 	AThePlayer* playerRef;
 
-	static ACustomGameMode* instance; //Create a singleton instance of this class
+	//Projectiles currently held on screen, one per touching finger
+	TProjectileLauncher<FRegularProjectilePolicy> regularLauncher;
+	TProjectileLauncher<FBombProjectilePolicy> bombLauncher;
+
+	UPROPERTY()
+	UItemDropPool* itemDropPool;
+
+	UPROPERTY()
+	UGameplayActorPool* actorPool;
+	bool prewarming = false;
+
+	UPROPERTY()
+	UUIManager* uiManager;
+
+	TSharedPtr<IVoiceCapture> voiceCapture;
+	int32 voiceCaptureUsers = 0;
+
 	TSubclassOf<ALevel0> levelInstance; //Base class is the class that blueprint uses
 	TSubclassOf<ALevel0> levelPlatformInstance;
 
+	//Replays a recorded AR session instead of the device when launched with -ARPlayback=<file>
+	TUniquePtr<FARSessionPlayback> sessionPlayback;
+	TMap<int32, FVector> playbackTouchStarts;
+	TOptional<double> recordedTouchTime; //Set while a recorded touch is dispatched so gesture samples keep their capture time
+
+	//Time each live touch event reached Slate, taken by the gesture samples instead of the time they are handled
+	TSharedPtr<FTouchTimestampProcessor> touchTimestamps;
+	bool playbackFinished = false;
+
+	//Async physics mode, launches are handed to the physics thread and applied at the start of its next step
+	struct FQueuedLaunch
+	{
+		Chaos::FSingleParticlePhysicsProxy* proxy; //Resolved on the game thread, the component is never touched on the physics thread
+		FVector velocity;
+	};
+	TQueue<FQueuedLaunch, EQueueMode::Spsc> queuedLaunches;
+
 	bool platformSpawned;
 	int levelIndex;
 };
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayActorPool.h"
+
+#include "BombProjectile.h"
+#include "Projectile.h"
+#include "TicTac.h"
+#include "Engine/World.h"
+
+void UGameplayActorPool::Initialise(UWorld* world)
+{
+	worldRef = world;
+}
+
+//Spawned out of sight and parked straight away, each actor's components and physics bodies are created here once
+void UGameplayActorPool::Prewarm(UClass* actorClass, int32 count)
+{
+	UWorld* world = worldRef.Get();
+	if(!world || !actorClass) return;
+
+	FActorSpawnParameters spawnInfo;
+	spawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	const FTransform hiddenTF(FVector(0.f, 0.f, -100000.f));
+
+	for(int32 index = 0; index < count; index++)
+	{
+		if(AActor* actor = world->SpawnActor<AActor>(actorClass, hiddenTF, spawnInfo))
+		{
+			Release(actor);
+		}
+	}
+
+	//Prewarmed actors are not churn
+	actorsReleased = 0;
+}
+
+AActor* UGameplayActorPool::Acquire(UClass* actorClass, const FTransform& transform)
+{
+	const int32 index = freeActors.IndexOfByPredicate([actorClass](const AActor* actor) { return actor->GetClass() == actorClass; });
+	if(index == INDEX_NONE)
+	{
+		acquireMisses++;
+		return nullptr;
+	}
+
+	AActor* actor = freeActors[index];
+	freeActors.RemoveAtSwap(index, 1, false);
+	actor->OnDestroyed.RemoveDynamic(this, &UGameplayActorPool::OnActorDestroyed);
+	actor->SetActorTransform(transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetPooled(actor, false);
+	actorsReused++;
+	return actor;
+}
+
+void UGameplayActorPool::Release(AActor* actor)
+{
+	if(!actor || freeActors.Contains(actor)) return;
+
+	//Only tracked while parked, an actor destroyed after it was handed out is not the pool's churn
+	actor->OnDestroyed.AddUniqueDynamic(this, &UGameplayActorPool::OnActorDestroyed);
+	actor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	actor->SetOwner(nullptr);
+	SetPooled(actor, true);
+	freeActors.Add(actor);
+	actorsReleased++;
+}
+
+void UGameplayActorPool::SetPooled(AActor* actor, bool pooled)
+{
+	//Tic tacs already park themselves for finished levels
+	if(ATicTac* ticTac = Cast<ATicTac>(actor))
+	{
+		ticTac->SetParked(pooled);
+		return;
+	}
+
+	actor->SetActorHiddenInGame(pooled);
+	actor->SetActorEnableCollision(!pooled);
+	actor->SetActorTickEnabled(!pooled);
+
+	//Held projectiles do not simulate until they are launched, and a pooled one is never a player throw
+	if(AProjectile* projectile = Cast<AProjectile>(actor))
+	{
+		projectile->SetPhysicsSimulation(false);
+		projectile->SetPlayerProjectile(false);
+	}
+
+	if(ABombProjectile* bomb = Cast<ABombProjectile>(actor))
+	{
+		bomb->SetPooled(pooled);
+	}
+}
+
+//A parked actor destroyed some other way is no longer tracked, a later acquire misses and the caller spawns one
+void UGameplayActorPool::OnActorDestroyed(AActor* destroyedActor)
+{
+	if(freeActors.RemoveSingleSwap(destroyedActor, false) > 0)
+	{
+		actorsDestroyed++;
+	}
+}
+
+void UGameplayActorPool::ReportStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Gameplay actor pool: %i free, %i reused, %i released, %i destroyed, %i misses"),
+		freeActors.Num(), actorsReused, actorsReleased, actorsDestroyed, acquireMisses);
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "GameplayActorPool.generated.h"
+
+/**
+ * Parked projectiles, bombs and tic tacs, prewarmed at start play. Acquire hands out a parked actor of exactly the
+ * class asked for and returns null when there is none, so the caller falls back to its own spawn. Release parks the
+ * actor instead of destroying it, whichever way it was spawned. Parked actors are hidden, have no collision or
+ * physics and never tick.
+ */
+UCLASS()
+class UE5_AR_API UGameplayActorPool : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void Initialise(UWorld* world);
+	void Prewarm(UClass* actorClass, int32 count);
+
+	AActor* Acquire(UClass* actorClass, const FTransform& transform);
+	void Release(AActor* actor);
+	void ReportStats() const;
+
+	template<typename T>
+	T* Acquire(const FTransform& transform) { return static_cast<T*>(Acquire(T::StaticClass(), transform)); }
+
+private:
+	static void SetPooled(AActor* actor, bool pooled);
+
+	UFUNCTION()
+	void OnActorDestroyed(AActor* destroyedActor);
+
+	//A few classes and a handful of actors each, a linear search is enough
+	UPROPERTY()
+	TArray<AActor*> freeActors;
+
+	TWeakObjectPtr<UWorld> worldRef;
+
+	//Stats for sizing the pool, every miss is an actor spawned mid game
+	int32 actorsReused = 0;
+	int32 actorsReleased = 0;
+	int32 actorsDestroyed = 0;
+	int32 acquireMisses = 0;
+};
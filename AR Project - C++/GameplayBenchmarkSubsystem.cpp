@@ -0,0 +1,325 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayBenchmarkSubsystem.h"
+
+#include "ARStats.h"
+#include "BombProjectile.h"
+#include "ContactDamageSubsystem.h"
+#include "CustomGameMode.h"
+#include "GameplayServicesSubsystem.h"
+#include "ItemDrop.h"
+#include "Level0.h"
+#include "TicTac.h"
+#include "TicTacSignificanceManager.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+
+bool UGameplayBenchmarkSubsystem::IsBenchmarkRequested()
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("GameplayBenchmark")) || FCString::Strifind(FCommandLine::Get(), TEXT("GameplayBenchmark=")) != nullptr;
+}
+
+bool UGameplayBenchmarkSubsystem::ShouldCreateSubsystem(UObject* outer) const
+{
+	return IsBenchmarkRequested() && Super::ShouldCreateSubsystem(outer);
+}
+
+void UGameplayBenchmarkSubsystem::OnWorldBeginPlay(UWorld& inWorld)
+{
+	Super::OnWorldBeginPlay(inWorld);
+	if(!inWorld.IsGameWorld()) return;
+
+	if(!FParse::Value(FCommandLine::Get(), TEXT("GameplayBenchmark="), scenarioName))
+	{
+		scenarioName = TEXT("Default");
+	}
+	FParse::Value(FCommandLine::Get(), TEXT("BenchDuration="), duration);
+	FParse::Value(FCommandLine::Get(), TEXT("BenchTurrets="), stressTurretCount);
+	FParse::Value(FCommandLine::Get(), TEXT("BenchTowers="), stressTowerCount);
+
+	//Procedural tower scaling, the recording places a generated tower of this size instead of the selected level
+	if(FParse::Value(FCommandLine::Get(), TEXT("BenchTowerBlocks="), generatedTowerBlocks))
+	{
+		if(IConsoleVariable* generatedBlocksVar = IConsoleManager::Get().FindConsoleVariable(TEXT("ar.GeneratedTowerBlocks")))
+		{
+			generatedBlocksVar->Set(generatedTowerBlocks, ECVF_SetByCommandline);
+		}
+	}
+
+	//A fixed simulated step makes every run simulate the same gameplay regardless of how fast frames are produced
+	float benchFPS = 30.f;
+	FParse::Value(FCommandLine::Get(), TEXT("BenchFPS="), benchFPS);
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / FMath::Max(benchFPS, 1.f));
+
+	int32 seed = 1;
+	FParse::Value(FCommandLine::Get(), TEXT("BenchSeed="), seed);
+	FMath::RandInit(seed);
+	FMath::SRandInit(seed);
+
+	if(FARSessionPlayback::GetCommandLinePath().IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Gameplay benchmark: no -ARPlayback recording given, nothing will place the level or throw"));
+	}
+
+	actorSpawnedHandle = inWorld.AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UGameplayBenchmarkSubsystem::OnActorSpawned));
+	if(FPhysScene_Chaos* physScene = inWorld.GetPhysicsScene())
+	{
+		physicsPreTickHandle = physScene->OnPhysScenePreTick.AddUObject(this, &UGameplayBenchmarkSubsystem::OnPhysicsPreTick);
+		physicsPostTickHandle = physScene->OnPhysScenePostTick.AddUObject(this, &UGameplayBenchmarkSubsystem::OnPhysicsPostTick);
+	}
+
+	const FARFrameStats& frameStats = FARFrameStats::Get();
+	startHitHandlingMs = frameStats.GetTotalMs(EARStat::ProjectileNotifyHit) + frameStats.GetTotalMs(EARStat::ContactDamageApply);
+	startNotifyHits = frameStats.GetTotalCalls(EARStat::ProjectileNotifyHit);
+	startHitches = frameStats.GetHitchCount();
+
+	samples.Reserve(FMath::CeilToInt(duration * benchFPS) + 1);
+	lastFrameTime = FPlatformTime::Seconds();
+	running = true;
+	UE_LOG(LogTemp, Log, TEXT("Gameplay benchmark: running scenario %s for %.1f simulated seconds"), *scenarioName, duration);
+}
+
+void UGameplayBenchmarkSubsystem::Deinitialize()
+{
+	if(UWorld* world = GetWorld())
+	{
+		world->RemoveOnActorSpawnedHandler(actorSpawnedHandle);
+		if(FPhysScene_Chaos* physScene = world->GetPhysicsScene())
+		{
+			physScene->OnPhysScenePreTick.Remove(physicsPreTickHandle);
+			physScene->OnPhysScenePostTick.Remove(physicsPostTickHandle);
+		}
+	}
+	
+	Super::Deinitialize();
+}
+
+void UGameplayBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	if(!running) return;
+
+	//Record the real time the frame took, the simulated step is fixed
+	const double now = FPlatformTime::Seconds();
+	FFrameSample& sample = samples.AddDefaulted_GetRef();
+	sample.frameMs = static_cast<float>((now - lastFrameTime) * 1000.0);
+	sample.physicsMs = physicsMsThisFrame;
+	sample.spawns = spawnsThisFrame;
+	
+	lastFrameTime = now;
+	physicsMsThisFrame = 0.f;
+	spawnsThisFrame = 0;
+	simulatedTime += DeltaTime;
+
+	const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+	ACustomGameMode* gameMode = services ? services->GetGameMode() : nullptr;
+
+	//Turret stress, fill the tower with extra tic tacs as soon as it has been placed
+	if(!stressTurretsSpawned && stressTurretCount > 0 && gameMode && gameMode->GetLevel())
+	{
+		gameMode->GetLevel()->SpawnStressTicTacs(stressTurretCount);
+		stressTurretsSpawned = true;
+	}
+
+	//Multi tower stress, the extra towers go up around the placed one and share its budgets
+	if(!stressTowersSpawned && stressTowerCount > 1 && gameMode && gameMode->GetLevel())
+	{
+		gameMode->SpawnExtraTowers(stressTowerCount - 1);
+		stressTowersSpawned = true;
+	}
+
+	if(const UTicTacSignificanceManager* significanceManager = GetWorld()->GetSubsystem<UTicTacSignificanceManager>())
+	{
+		peakTurretsFullRate = FMath::Max(peakTurretsFullRate, significanceManager->GetNumFullRate());
+		peakTurretsPaused = FMath::Max(peakTurretsPaused, significanceManager->GetNumPaused());
+	}
+
+	//Finish once the simulated time is up and the recording has played out
+	const bool playbackDone = !gameMode || !gameMode->IsPlaybackActive() || gameMode->IsPlaybackFinished();
+	if(simulatedTime >= duration && playbackDone)
+	{
+		Finish();
+	}
+}
+
+TStatId UGameplayBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGameplayBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UGameplayBenchmarkSubsystem::OnActorSpawned(AActor* actor)
+{
+	//Pools filling up at start play are not gameplay spawns
+	const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+	const ACustomGameMode* gameMode = services ? services->GetGameMode() : nullptr;
+	if(gameMode && gameMode->IsPrewarming()) return;
+	
+	spawnsThisFrame++;
+	
+	if(actor->IsA<ATicTac>()) ticTacSpawns++;
+	else if(actor->IsA<ABombProjectile>()) bombSpawns++;
+	else if(actor->IsA<AProjectile>()) projectileSpawns++;
+	else if(actor->IsA<AItemDrop>()) itemDropSpawns++;
+}
+
+void UGameplayBenchmarkSubsystem::OnPhysicsPreTick(FPhysScene_Chaos* scene, float deltaSeconds)
+{
+	physicsStartTime = FPlatformTime::Seconds();
+}
+
+void UGameplayBenchmarkSubsystem::OnPhysicsPostTick(FPhysScene_Chaos* scene)
+{
+	physicsMsThisFrame += static_cast<float>((FPlatformTime::Seconds() - physicsStartTime) * 1000.0);
+}
+
+void UGameplayBenchmarkSubsystem::Finish()
+{
+	running = false;
+	FApp::SetUseFixedTimeStep(false);
+	
+	const FString outputDir = FPaths::Combine(FPaths::ProfilingDir(), TEXT("GameplayBenchmark"));
+
+	//Per frame samples
+	FString framesCsv = TEXT("frame,frame_ms,physics_ms,spawns\n");
+	for(int32 index = 0; index < samples.Num(); index++)
+	{
+		const FFrameSample& sample = samples[index];
+		framesCsv += FString::Printf(TEXT("%i,%.3f,%.3f,%i\n"), index, sample.frameMs, sample.physicsMs, sample.spawns);
+	}
+	FFileHelper::SaveStringToFile(framesCsv, *FPaths::Combine(outputDir, scenarioName + TEXT("_frames.csv")));
+
+	//Summary, in the same key,value format the baseline is read from so a good run can be promoted to the baseline
+	TArray<TPair<FString, double>> summary;
+	BuildSummary(summary);
+	
+	FString summaryCsv;
+	for(const TPair<FString, double>& metric : summary)
+	{
+		summaryCsv += FString::Printf(TEXT("%s,%.4f\n"), *metric.Key, metric.Value);
+		UE_LOG(LogTemp, Log, TEXT("Gameplay benchmark: %s = %.4f"), *metric.Key, metric.Value);
+	}
+	const FString summaryPath = FPaths::Combine(outputDir, scenarioName + TEXT("_summary.csv"));
+	FFileHelper::SaveStringToFile(summaryCsv, *summaryPath);
+	UE_LOG(LogTemp, Log, TEXT("Gameplay benchmark: results written to %s"), *summaryPath);
+
+	const bool passed = CompareAgainstBaseline(summary);
+	FPlatformMisc::RequestExitWithStatus(false, passed ? 0 : 1);
+}
+
+void UGameplayBenchmarkSubsystem::BuildSummary(TArray<TPair<FString, double>>& outSummary) const
+{
+	TArray<float> frameTimes;
+	TArray<float> physicsTimes;
+	frameTimes.Reserve(samples.Num());
+	physicsTimes.Reserve(samples.Num());
+	
+	double physicsTotal = 0.0;
+	for(const FFrameSample& sample : samples)
+	{
+		frameTimes.Add(sample.frameMs);
+		physicsTimes.Add(sample.physicsMs);
+		physicsTotal += sample.physicsMs;
+	}
+	frameTimes.Sort();
+	physicsTimes.Sort();
+
+	outSummary.Emplace(TEXT("frames"), samples.Num());
+	outSummary.Emplace(TEXT("frame_p50_ms"), Percentile(frameTimes, 0.5));
+	outSummary.Emplace(TEXT("frame_p90_ms"), Percentile(frameTimes, 0.9));
+	outSummary.Emplace(TEXT("frame_p99_ms"), Percentile(frameTimes, 0.99));
+	outSummary.Emplace(TEXT("physics_mean_ms"), samples.Num() > 0 ? physicsTotal / samples.Num() : 0.0);
+	outSummary.Emplace(TEXT("physics_p99_ms"), Percentile(physicsTimes, 0.99));
+	outSummary.Emplace(TEXT("spawns_tictac"), ticTacSpawns);
+	outSummary.Emplace(TEXT("spawns_projectile"), projectileSpawns);
+	outSummary.Emplace(TEXT("spawns_bomb"), bombSpawns);
+	outSummary.Emplace(TEXT("spawns_itemdrop"), itemDropSpawns);
+	outSummary.Emplace(TEXT("turrets_stress"), stressTurretCount);
+	outSummary.Emplace(TEXT("turrets_full_rate_peak"), peakTurretsFullRate);
+	outSummary.Emplace(TEXT("turrets_paused_peak"), peakTurretsPaused);
+	outSummary.Emplace(TEXT("towers"), FMath::Max(stressTowerCount, 1));
+	outSummary.Emplace(TEXT("tower_blocks_generated"), generatedTowerBlocks);
+
+	//Game thread time spent resolving projectile hits, NotifyHit plus applying the drained physics thread contacts
+	const FARFrameStats& frameStats = FARFrameStats::Get();
+	const double hitHandlingMs = frameStats.GetTotalMs(EARStat::ProjectileNotifyHit) + frameStats.GetTotalMs(EARStat::ContactDamageApply);
+	outSummary.Emplace(TEXT("hit_handling_total_ms"), hitHandlingMs - startHitHandlingMs);
+	const double hitNotifies = static_cast<double>(frameStats.GetTotalCalls(EARStat::ProjectileNotifyHit) - startNotifyHits);
+	outSummary.Emplace(TEXT("hit_notifies"), hitNotifies);
+	outSummary.Emplace(TEXT("hit_notifies_per_s"), simulatedTime > 0.f ? hitNotifies / simulatedTime : 0.0);
+	outSummary.Emplace(TEXT("hitches"), frameStats.GetHitchCount() - startHitches);
+	
+	const UContactDamageSubsystem* contactDamage = GetWorld()->GetSubsystem<UContactDamageSubsystem>();
+	outSummary.Emplace(TEXT("contact_pairs_filtered"), contactDamage ? contactDamage->GetPairsFiltered() : 0);
+	const double contactEvents = contactDamage ? static_cast<double>(contactDamage->GetContactEvents()) : 0.0;
+	outSummary.Emplace(TEXT("contact_damage_events"), contactEvents);
+	outSummary.Emplace(TEXT("contact_damage_events_per_s"), simulatedTime > 0.f ? contactEvents / simulatedTime : 0.0);
+	outSummary.Emplace(TEXT("determinism_hash"), ComputeDeterminismHash());
+}
+
+//Combines the state of every tower with the spawn counts, identical runs produce the same value
+uint32 UGameplayBenchmarkSubsystem::ComputeDeterminismHash() const
+{
+	uint32 hash = HashCombine(GetTypeHash(ticTacSpawns), GetTypeHash(bombSpawns));
+	hash = HashCombine(hash, GetTypeHash(projectileSpawns));
+	hash = HashCombine(hash, GetTypeHash(itemDropSpawns));
+	
+	for(TActorIterator<ALevel0> level(GetWorld()); level; ++level)
+	{
+		hash = HashCombine(hash, level->ComputeStateHash());
+	}
+	return hash;
+}
+
+bool UGameplayBenchmarkSubsystem::CompareAgainstBaseline(const TArray<TPair<FString, double>>& summary) const
+{
+	FString baselinePath;
+	if(!FParse::Value(FCommandLine::Get(), TEXT("BenchBaseline="), baselinePath)) return true;
+
+	TArray<FString> lines;
+	if(!FFileHelper::LoadFileToStringArray(lines, *baselinePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Gameplay benchmark: could not read baseline %s"), *baselinePath);
+		return false;
+	}
+
+	float tolerance = 0.1f;
+	FParse::Value(FCommandLine::Get(), TEXT("BenchTolerance="), tolerance);
+
+	bool passed = true;
+	for(const FString& line : lines)
+	{
+		FString key, value;
+		if(!line.Split(TEXT(","), &key, &value)) continue;
+
+		const TPair<FString, double>* metric = summary.FindByPredicate([&key](const TPair<FString, double>& entry) { return entry.Key == key; });
+		if(!metric) continue;
+
+		//Timings gate the run against the tolerance and hashes have to match exactly, spawn counts are reported for context
+		const double baseline = FCString::Atod(*value);
+		if(key.EndsWith(TEXT("_ms")) && metric->Value > baseline * (1.0 + tolerance))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Gameplay benchmark: %s regressed, %.4f against baseline %.4f"), *key, metric->Value, baseline);
+			passed = false;
+		}
+		else if(key.EndsWith(TEXT("_hash")) && metric->Value != baseline)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Gameplay benchmark: %s differs, %.0f against baseline %.0f, the run was not deterministic"), *key, metric->Value, baseline);
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+double UGameplayBenchmarkSubsystem::Percentile(const TArray<float>& sortedValues, double percentile)
+{
+	if(sortedValues.Num() == 0) return 0.0;
+	const int32 index = FMath::Clamp(FMath::CeilToInt(percentile * sortedValues.Num()) - 1, 0, sortedValues.Num() - 1);
+	return sortedValues[index];
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayBenchmarkSubsystem.generated.h"
+
+class FPhysScene_Chaos;
+
+/**
+ * Headless gameplay benchmark, enabled with -GameplayBenchmark=<scenario>.
+ * Runs the world at a fixed simulated step while a recorded session (-ARPlayback=<file>) places the level
+ * and throws, records frame time, physics time and spawn counts per frame, writes them as CSV to
+ * Saved/Profiling/GameplayBenchmark and compares the summary against -BenchBaseline=<summary csv>.
+ * The process exits with a non-zero code when a timing metric regresses past -BenchTolerance (default 0.1).
+ * -BenchTurrets=<count> adds that many extra tic tacs once the level is placed, the turret stress
+ * scenario runs it at 50, 200 and 1000.
+ * -BenchTowers=<count> puts up that many copies of the placed tower sharing the tower budgets, the multi
+ * tower scenario compares frame time at 1, 4 and 8.
+ * -BenchTowerBlocks=<count> places a procedural tower of that many blocks instead of the recorded level, the
+ * scaling scenario runs the 10, 100, 1000 and 10000 block presets.
+ * determinism_hash summarises the final tower state. Running with -ARAsyncPhysics at two different -BenchFPS
+ * values against each other's summary checks that the fixed step physics gives the same outcome.
+ */
+UCLASS()
+class UE5_AR_API UGameplayBenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static bool IsBenchmarkRequested();
+
+	virtual bool ShouldCreateSubsystem(UObject* outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& inWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FFrameSample
+	{
+		float frameMs = 0.f;
+		float physicsMs = 0.f;
+		int32 spawns = 0;
+	};
+
+	void OnActorSpawned(AActor* actor);
+	void OnPhysicsPreTick(FPhysScene_Chaos* scene, float deltaSeconds);
+	void OnPhysicsPostTick(FPhysScene_Chaos* scene);
+	
+	void Finish();
+	void BuildSummary(TArray<TPair<FString, double>>& outSummary) const;
+	bool CompareAgainstBaseline(const TArray<TPair<FString, double>>& summary) const;
+	uint32 ComputeDeterminismHash() const;
+
+	static double Percentile(const TArray<float>& sortedValues, double percentile);
+
+	TArray<FFrameSample> samples;
+	FString scenarioName;
+	FDelegateHandle actorSpawnedHandle;
+	FDelegateHandle physicsPreTickHandle;
+	FDelegateHandle physicsPostTickHandle;
+
+	double lastFrameTime = 0.0;
+	double physicsStartTime = 0.0;
+	float physicsMsThisFrame = 0.f;
+	int32 spawnsThisFrame = 0;
+	float simulatedTime = 0.f;
+	float duration = 30.f;
+	bool running = false;
+	int32 stressTurretCount = 0;
+	bool stressTurretsSpawned = false;
+	int32 stressTowerCount = 1;
+	bool stressTowersSpawned = false;
+	int32 generatedTowerBlocks = 0;
+
+	int32 ticTacSpawns = 0;
+	int32 projectileSpawns = 0;
+	int32 bombSpawns = 0;
+	int32 itemDropSpawns = 0;
+	int32 peakTurretsPaused = 0;
+	int32 peakTurretsFullRate = 0;
+
+	//Hit handling totals when the run started, the summary reports the difference
+	double startHitHandlingMs = 0.0;
+	uint64 startNotifyHits = 0;
+	uint32 startHitches = 0;
+};
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayEventSubsystem.h"
+
+#include "ARStats.h"
+#include "GameplayServicesSubsystem.h"
+#include "Level0.h"
+#include "ThePlayer.h"
+
+UGameplayEventSubsystem* UGameplayEventSubsystem::Get(const UObject* worldContext)
+{
+	const UWorld* world = worldContext ? worldContext->GetWorld() : nullptr;
+	return world ? world->GetSubsystem<UGameplayEventSubsystem>() : nullptr;
+}
+
+void UGameplayEventSubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	queued.Reserve(reservedEvents);
+	processing.Reserve(reservedEvents);
+	blockDamage.Reserve(reservedEvents / 4);
+
+	//Post actor tick runs after the tick groups and the tickable objects, so contacts drained this frame are included
+	postActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UGameplayEventSubsystem::OnWorldPostActorTick);
+}
+
+void UGameplayEventSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(postActorTickHandle);
+	Super::Deinitialize();
+}
+
+void UGameplayEventSubsystem::AddScore(int32 amount)
+{
+	Enqueue(EGameplayEventType::Score, amount, nullptr);
+}
+
+void UGameplayEventSubsystem::DamageBlock(UStaticMeshComponent* block, int32 damage)
+{
+	Enqueue(EGameplayEventType::BlockDamage, damage, block);
+}
+
+void UGameplayEventSubsystem::LevelCleared(ALevel0* level)
+{
+	Enqueue(EGameplayEventType::LevelCleared, 0, level);
+}
+
+void UGameplayEventSubsystem::Enqueue(EGameplayEventType type, int32 amount, UObject* target)
+{
+	FGameplayEvent& event = queued.AddDefaulted_GetRef();
+	event.type = type;
+	event.amount = amount;
+	event.target = target;
+}
+
+void UGameplayEventSubsystem::OnWorldPostActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds)
+{
+	if(world == GetWorld())
+	{
+		ProcessEvents();
+	}
+}
+
+void UGameplayEventSubsystem::ProcessEvents()
+{
+	if(queued.Num() == 0) return;
+	AR_SCOPED_STAT(GameplayEventFlush);
+
+	//Clearing a level can queue more events, e.g. its own clear, keep going until nothing new comes in
+	for(int32 pass = 0; pass < 4 && queued.Num() > 0; pass++)
+	{
+		INC_DWORD_STAT_BY(STAT_AR_GameplayEvents, queued.Num());
+		Swap(queued, processing);
+
+		int32 score = 0;
+		blockDamage.Reset();
+		damagedLevels.Reset();
+		clearedLevels.Reset();
+		for(const FGameplayEvent& event : processing)
+		{
+			switch(event.type)
+			{
+			case EGameplayEventType::Score:
+				score += event.amount;
+				break;
+
+			case EGameplayEventType::BlockDamage:
+				if(UStaticMeshComponent* block = Cast<UStaticMeshComponent>(event.target.Get()))
+				{
+					blockDamage.FindOrAdd(block) += event.amount;
+					damagedLevels.AddUnique(Cast<ALevel0>(block->GetOwner()));
+				}
+				break;
+
+			case EGameplayEventType::LevelCleared:
+				clearedLevels.AddUnique(Cast<ALevel0>(event.target.Get()));
+				break;
+			}
+		}
+		processing.Reset();
+		INC_DWORD_STAT_BY(STAT_AR_GameplayEventsCoalesced, blockDamage.Num() + clearedLevels.Num() + (score != 0 ? 1 : 0));
+
+		for(const TPair<TWeakObjectPtr<UStaticMeshComponent>, int32>& entry : blockDamage)
+		{
+			UStaticMeshComponent* block = entry.Key.Get();
+			ALevel0* level = block ? Cast<ALevel0>(block->GetOwner()) : nullptr;
+			if(level) level->ApplyDamage(block, entry.Value);
+		}
+
+		//One drop and clear check per level however many of its blocks were hit
+		for(const TWeakObjectPtr<ALevel0>& level : damagedLevels)
+		{
+			if(level.IsValid()) level->ItemDrop();
+		}
+
+		//Scored before any level finishes, finishing a level resets the score
+		if(score != 0)
+		{
+			const UGameplayServicesSubsystem* services = UGameplayServicesSubsystem::Get(this);
+			if(AThePlayer* player = services ? services->GetPlayer() : nullptr)
+			{
+				player->IncrementScore(score);
+			}
+		}
+
+		for(const TWeakObjectPtr<ALevel0>& level : clearedLevels)
+		{
+			if(level.IsValid()) level->CompleteLevel();
+		}
+	}
+}
+
+bool UGameplayEventSubsystem::DoesSupportWorldType(const EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayEventSubsystem.generated.h"
+
+class ALevel0;
+class UStaticMeshComponent;
+
+enum class EGameplayEventType : uint8
+{
+	Score,
+	BlockDamage,
+	LevelCleared
+};
+
+struct FGameplayEvent
+{
+	EGameplayEventType type = EGameplayEventType::Score;
+	int32 amount = 0;
+	TWeakObjectPtr<UObject> target; //The damaged block or the cleared level, unused for score
+};
+
+/**
+ * Queue for the gameplay consequences of collisions. Hit handlers only record what happened, and once a frame,
+ * after every actor and tickable has run, the queue is coalesced: damage is summed per block, each damaged level
+ * runs its drop and clear check once, the score gets a single update and cleared levels finish last.
+ * The queues are reserved up front and swapped, so queuing and processing do not allocate once warmed up.
+ */
+UCLASS()
+class UE5_AR_API UGameplayEventSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UGameplayEventSubsystem* Get(const UObject* worldContext);
+
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+	virtual void Deinitialize() override;
+
+	void AddScore(int32 amount);
+	void DamageBlock(UStaticMeshComponent* block, int32 damage);
+	void LevelCleared(ALevel0* level);
+
+	//Runs at the end of every frame, callable directly when a caller needs the results straight away
+	void ProcessEvents();
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type worldType) const override;
+
+private:
+	static constexpr int32 reservedEvents = 1024;
+	
+	void Enqueue(EGameplayEventType type, int32 amount, UObject* target);
+	void OnWorldPostActorTick(UWorld* world, ELevelTick tickType, float deltaSeconds);
+
+	TArray<FGameplayEvent> queued;
+	TArray<FGameplayEvent> processing;
+
+	//Coalescing scratch, reset each pass without freeing
+	TMap<TWeakObjectPtr<UStaticMeshComponent>, int32> blockDamage;
+	TArray<TWeakObjectPtr<ALevel0>, TInlineAllocator<4>> damagedLevels;
+	TArray<TWeakObjectPtr<ALevel0>, TInlineAllocator<4>> clearedLevels;
+
+	FDelegateHandle postActorTickHandle;
+};
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayServicesSubsystem.h"
+
+#include "CustomGameMode.h"
+#include "HelloARManager.h"
+#include "ThePlayer.h"
+#include "Engine/World.h"
+
+UGameplayServicesSubsystem* UGameplayServicesSubsystem::Get(const UObject* worldContext)
+{
+	const UWorld* world = worldContext ? worldContext->GetWorld() : nullptr;
+	return world ? world->GetSubsystem<UGameplayServicesSubsystem>() : nullptr;
+}
+
+void UGameplayServicesSubsystem::RegisterGameMode(ACustomGameMode* gameMode)
+{
+	gameModeRef = gameMode;
+}
+
+void UGameplayServicesSubsystem::RegisterPlayer(AThePlayer* player)
+{
+	playerRef = player;
+}
+
+void UGameplayServicesSubsystem::RegisterARManager(AHelloARManager* arManager)
+{
+	arManagerRef = arManager;
+}
+
+//Only game worlds have gameplay services, editor and preview worlds skip the subsystem
+bool UGameplayServicesSubsystem::DoesSupportWorldType(const EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
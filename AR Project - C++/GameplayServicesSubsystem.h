@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayServicesSubsystem.generated.h"
+
+class ACustomGameMode;
+class AThePlayer;
+class AHelloARManager;
+
+/**
+ * Registry for the gameplay services every actor needs (game mode, player and AR manager).
+ * The owners register themselves once and actors resolve typed handles at BeginPlay,
+ * so nothing has to look up and cast the game mode in constructors or hot paths.
+ */
+UCLASS()
+class UE5_AR_API UGameplayServicesSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	static UGameplayServicesSubsystem* Get(const UObject* worldContext);
+
+	void RegisterGameMode(ACustomGameMode* gameMode);
+	void RegisterPlayer(AThePlayer* player);
+	void RegisterARManager(AHelloARManager* arManager);
+
+	ACustomGameMode* GetGameMode() const { return gameModeRef.Get(); }
+	AThePlayer* GetPlayer() const { return playerRef.Get(); }
+	AHelloARManager* GetARManager() const { return arManagerRef.Get(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type worldType) const override;
+
+private:
+	TWeakObjectPtr<ACustomGameMode> gameModeRef;
+	TWeakObjectPtr<AThePlayer> playerRef;
+	TWeakObjectPtr<AHelloARManager> arManagerRef;
+};
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GestureVelocityEstimator.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+void FGestureVelocityEstimator::Reset()
+{
+	head = 0;
+	count = 0;
+}
+
+void FGestureVelocityEstimator::AddSample(double time, const FVector& position)
+{
+	samples[head] = { time, position };
+	head = (head + 1) % capacity;
+	count = FMath::Min(count + 1, capacity);
+}
+
+bool FGestureVelocityEstimator::Estimate(double now, FVector& outVelocity, double window, double* outLatency) const
+{
+	if(count == 0) return false;
+
+	//Held still long enough that nothing is left in the window
+	if(now - GetNewest(0).time > window)
+	{
+		outVelocity = FVector::ZeroVector;
+		return true;
+	}
+
+	int32 used = 0;
+	while(used < count && now - GetNewest(used).time <= window)
+	{
+		used++;
+	}
+	
+	//A single sample in the window still pairs with the one before it
+	used = FMath::Min(FMath::Max(used, 2), count);
+	if(used < 2) return false;
+
+	//Times are taken relative to now so the sums keep their precision, weights fall from 1 to 0.5 across the window
+	double weightSum = 0.0;
+	double timeMean = 0.0;
+	FVector positionMean = FVector::ZeroVector;
+	for(int32 age = 0; age < used; age++)
+	{
+		const FSample& sample = GetNewest(age);
+		const double weight = 1.0 - 0.5 * FMath::Min((now - sample.time) / window, 1.0);
+		weightSum += weight;
+		timeMean += weight * (sample.time - now);
+		positionMean += weight * sample.position;
+	}
+	timeMean /= weightSum;
+	positionMean /= weightSum;
+
+	double timeVariance = 0.0;
+	FVector covariance = FVector::ZeroVector;
+	for(int32 age = 0; age < used; age++)
+	{
+		const FSample& sample = GetNewest(age);
+		const double weight = 1.0 - 0.5 * FMath::Min((now - sample.time) / window, 1.0);
+		const double dt = (sample.time - now) - timeMean;
+		timeVariance += weight * dt * dt;
+		covariance += weight * dt * (sample.position - positionMean);
+	}
+
+	if(timeVariance <= UE_DOUBLE_SMALL_NUMBER) return false;
+
+	outVelocity = covariance / timeVariance;
+	if(outLatency) *outLatency = -timeMean;
+	return true;
+}
+
+//Compares the least-squares fit against the old frame difference on synthetic swipes with a known release velocity
+static FAutoConsoleCommand ARGestureVelocityBenchCommand(
+	TEXT("ar.Bench.GestureVelocity"),
+	TEXT("Replays synthetic swipe traces (120 Hz touch input, 30 Hz frames, sensor noise) and logs the release velocity error and latency of the least-squares estimator against the frame difference. Usage: ar.Bench.GestureVelocity [swipes, default 200]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+	{
+		const int32 swipes = FMath::Max(args.Num() > 0 ? FCString::Atoi(*args[0]) : 200, 1);
+		const double inputStep = 1.0 / 120.0;
+		const double frameStep = 1.0 / 30.0;
+		FRandomStream random(1234);
+
+		double fitError = 0.0;
+		double frameError = 0.0;
+		double fitLatency = 0.0;
+		double frameLatency = 0.0;
+		uint64 fitCycles = 0;
+
+		for(int32 swipe = 0; swipe < swipes; swipe++)
+		{
+			//Accelerating swipe, the true velocity at release is the derivative of the path at the release time
+			const FVector direction = FVector(random.FRandRange(-1.f, 1.f), random.FRandRange(0.2f, 1.f), random.FRandRange(0.f, 0.5f)).GetSafeNormal();
+			const double speed = random.FRandRange(100.f, 600.f);
+			const double duration = random.FRandRange(0.15f, 0.4f);
+			auto path = [&](double t) { return direction * (speed * t * t / (2.0 * duration)); };
+			const FVector trueVelocity = direction * speed;
+
+			FGestureVelocityEstimator estimator;
+			FVector lastFramePosition = path(0.0);
+			FVector previousFramePosition = lastFramePosition;
+			double lastFrameTime = 0.0;
+			
+			for(double t = 0.0; t <= duration + KINDA_SMALL_NUMBER; t += inputStep)
+			{
+				const FVector noise(random.FRandRange(-0.3f, 0.3f), random.FRandRange(-0.3f, 0.3f), random.FRandRange(-0.3f, 0.3f));
+				const FVector position = path(t) + noise;
+				estimator.AddSample(t, position);
+
+				//The old path only saw the position once a frame and took the difference of the last two frames
+				if(t - lastFrameTime >= frameStep)
+				{
+					previousFramePosition = lastFramePosition;
+					lastFramePosition = position;
+					lastFrameTime = t;
+				}
+			}
+
+			FVector fitVelocity;
+			double swipeFitLatency = 0.0;
+			const uint64 startCycles = FPlatformTime::Cycles64();
+			estimator.Estimate(duration, fitVelocity, FGestureVelocityEstimator::defaultWindow, &swipeFitLatency);
+			fitCycles += FPlatformTime::Cycles64() - startCycles;
+
+			const FVector frameVelocity = (lastFramePosition - previousFramePosition) / frameStep;
+			fitError += (fitVelocity - trueVelocity).Size() / speed;
+			frameError += (frameVelocity - trueVelocity).Size() / speed;
+			
+			//Latency is how far behind the release the centre of the data each estimate uses sits
+			fitLatency += swipeFitLatency;
+			frameLatency += (duration - lastFrameTime) + frameStep * 0.5;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Gesture velocity over %i swipes: least squares %.1f%% error, %.1f ms latency, %.2f us per estimate"),
+			swipes, 100.0 * fitError / swipes, 1000.0 * fitLatency / swipes, FPlatformTime::ToMilliseconds64(fitCycles) * 1000.0 / swipes);
+		UE_LOG(LogTemp, Display, TEXT("Gesture velocity over %i swipes: frame difference %.1f%% error, %.1f ms latency"),
+			swipes, 100.0 * frameError / swipes, 1000.0 * frameLatency / swipes);
+	}));
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+
+/**
+ * Estimates the velocity of a dragged point from timestamped samples taken at input rate. Keeps the most recent
+ * samples in a fixed ring and fits a weighted least-squares line through the ones inside the fit window, newer
+ * samples weighing more, so the release velocity uses every touch event up to the release instead of the
+ * difference between the last two rendered frames.
+ */
+class UE5_AR_API FGestureVelocityEstimator
+{
+public:
+	static constexpr int32 capacity = 32;
+	static constexpr double defaultWindow = 0.08;
+
+	void Reset();
+	void AddSample(double time, const FVector& position);
+
+	//False when there is not enough history to fit, a finger that has not moved within the window estimates zero.
+	//outLatency is how far before now the weighted centre of the samples used by the fit sits
+	bool Estimate(double now, FVector& outVelocity, double window = defaultWindow, double* outLatency = nullptr) const;
+
+	int32 Num() const { return count; }
+
+private:
+	struct FSample
+	{
+		double time = 0.0;
+		FVector position = FVector::ZeroVector;
+	};
+
+	const FSample& GetNewest(int32 age) const { return samples[(head - 1 - age + capacity) % capacity]; }
+
+	TStaticArray<FSample, capacity> samples;
+	int32 head = 0;
+	int32 count = 0;
+};
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ItemDropPool.h"
+
+#include "ItemDrop.h"
+
+void UItemDropPool::Initialise(UWorld* world, TSubclassOf<AItemDrop> dropClass, int32 prewarmCount)
+{
+	worldRef = world;
+	itemDropClass = dropClass;
+	pendingDrops.Reserve(maxLiveDrops);
+
+	//Spawn the pool up front so no drops have to be created mid game
+	for(int32 index = 0; index < prewarmCount; index++)
+	{
+		if(AItemDrop* drop = CreateDrop())
+		{
+			DeactivateDrop(drop);
+			freeDrops.Add(drop);
+		}
+	}
+	
+	//Prewarmed drops are not churn
+	actorsCreated = 0;
+}
+
+void UItemDropPool::RequestDrop(const FVector& location, const FRotator& rotation)
+{
+	//Anything past the live cap would only recycle a drop queued this frame
+	if(pendingDrops.Num() >= maxLiveDrops)
+	{
+		requestsDiscarded++;
+		return;
+	}
+	
+	pendingDrops.Emplace(rotation, location);
+}
+
+void UItemDropPool::Tick()
+{
+	const int32 spawnCount = FMath::Min(pendingDrops.Num(), maxSpawnsPerFrame);
+	int32 spawned = 0;
+	
+	for(int32 index = 0; index < spawnCount; index++)
+	{
+		AItemDrop* drop = Acquire();
+		if(!drop) break;
+
+		//Bring the pooled drop back into the world at the destroyed block
+		drop->SetActorTransform(pendingDrops[index], false, nullptr, ETeleportType::ResetPhysics);
+		drop->SetActorHiddenInGame(false);
+		drop->SetActorEnableCollision(true);
+		drop->SetActorTickEnabled(true);
+		liveDrops.Add(drop);
+		spawned++;
+	}
+
+	//Requests that could not get a drop stay queued for the next frame
+	pendingDrops.RemoveAt(0, spawned, false);
+	peakSpawnsPerFrame = FMath::Max(peakSpawnsPerFrame, spawned);
+}
+
+AItemDrop* UItemDropPool::Acquire()
+{
+	if(freeDrops.Num() > 0)
+	{
+		actorsReused++;
+		return freeDrops.Pop(false);
+	}
+
+	if(liveDrops.Num() < maxLiveDrops)
+	{
+		return CreateDrop();
+	}
+
+	//At the cap, recycle the oldest drop still in the world
+	AItemDrop* oldest = liveDrops[0];
+	liveDrops.RemoveAt(0, 1, false);
+	DeactivateDrop(oldest);
+	actorsReused++;
+	return oldest;
+}
+
+AItemDrop* UItemDropPool::CreateDrop()
+{
+	UWorld* world = worldRef.Get();
+	if(!world || !itemDropClass) return nullptr;
+
+	FActorSpawnParameters spawnInfo;
+	spawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	
+	AItemDrop* drop = world->SpawnActor<AItemDrop>(itemDropClass, FTransform::Identity, spawnInfo);
+	if(drop)
+	{
+		drop->OnDestroyed.AddDynamic(this, &UItemDropPool::OnDropDestroyed);
+		actorsCreated++;
+	}
+	return drop;
+}
+
+void UItemDropPool::DeactivateDrop(AItemDrop* drop)
+{
+	drop->SetActorHiddenInGame(true);
+	drop->SetActorEnableCollision(false);
+	drop->SetActorTickEnabled(false);
+}
+
+//Collected drops come back here instead of being destroyed, so the next request reuses them
+void UItemDropPool::ReleaseDrop(AItemDrop* drop)
+{
+	if(!drop || liveDrops.RemoveSingle(drop) == 0) return;
+
+	DeactivateDrop(drop);
+	freeDrops.Add(drop);
+}
+
+//A drop destroyed some other way is no longer tracked, the pool refills with new ones
+void UItemDropPool::OnDropDestroyed(AActor* destroyedActor)
+{
+	AItemDrop* drop = static_cast<AItemDrop*>(destroyedActor);
+	liveDrops.RemoveSingle(drop);
+	freeDrops.RemoveSingle(drop);
+	actorsDestroyed++;
+}
+
+void UItemDropPool::ReportStats() const
+{
+	UE_LOG(LogTemp, Log, TEXT("Item drop pool: peak %i spawns per frame, %i live, %i free, %i created, %i reused, %i destroyed, %i requests discarded"),
+		peakSpawnsPerFrame, liveDrops.Num(), freeDrops.Num(), actorsCreated, actorsReused, actorsDestroyed, requestsDiscarded);
+}
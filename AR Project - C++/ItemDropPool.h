@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "ItemDropPool.generated.h"
+
+class AItemDrop;
+
+/**
+ * Prewarmed pool of item drops. Drop requests are queued and spawned a few per frame,
+ * and the number of drops alive at once is capped by recycling the oldest one. Collecting a drop
+ * releases it back to the pool rather than destroying it.
+ */
+UCLASS()
+class UE5_AR_API UItemDropPool : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void Initialise(UWorld* world, TSubclassOf<AItemDrop> dropClass, int32 prewarmCount);
+	void RequestDrop(const FVector& location, const FRotator& rotation);
+	void Tick();
+	void ReportStats() const;
+
+	//Called when the player collects a drop, hides it and returns it to the free list
+	UFUNCTION(BlueprintCallable, Category = "Item Drops")
+	void ReleaseDrop(AItemDrop* drop);
+
+	int32 maxSpawnsPerFrame = 2;
+	int32 maxLiveDrops = 12;
+
+private:
+	AItemDrop* Acquire();
+	AItemDrop* CreateDrop();
+	void DeactivateDrop(AItemDrop* drop);
+
+	UFUNCTION()
+	void OnDropDestroyed(AActor* destroyedActor);
+
+	UPROPERTY()
+	TArray<AItemDrop*> freeDrops;
+	
+	UPROPERTY()
+	TArray<AItemDrop*> liveDrops; //Oldest first so the cap recycles the longest lived drop
+
+	TArray<FTransform> pendingDrops;
+	TWeakObjectPtr<UWorld> worldRef;
+	TSubclassOf<AItemDrop> itemDropClass;
+
+	//Stats for tracking spawn spikes and garbage collection churn
+	int32 peakSpawnsPerFrame = 0;
+	int32 actorsCreated = 0;
+	int32 actorsReused = 0;
+	int32 actorsDestroyed = 0;
+	int32 requestsDiscarded = 0;
+};
@@ -3,14 +3,30 @@
 #include "Level0.h"
 
 #include "ARPin.h"
+#include "ARCollisionChannels.h"
+#include "ARGameplaySettings.h"
+#include "ARStats.h"
+#include "ContactDamageSubsystem.h"
+#include "GameplayActorPool.h"
+#include "GameplayEventSubsystem.h"
+#include "ItemDropPool.h"
+#include "LevelLayoutData.h"
+#include "UIManager.h"
+#include "GameplayServicesSubsystem.h"
 #include "ThePlayer.h"
+#include "TowerBudgetManager.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/MemStack.h"
+
+//Blocks closer than this fraction of the smallest block extent count as touching
+static constexpr float BlockContactTolerance = 0.05f;
 
 // Sets default values
 ALevel0::ALevel0()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	bAsyncPhysicsTickEnabled = UARGameplaySettings::Get()->IsAsyncPhysicsEnabled();
 	sceneComponent = CreateDefaultSubobject<USceneComponent>(TEXT("SceneComponent"));
 	SetRootComponent(sceneComponent);
 	sceneComponent->SetMobility(EComponentMobility::Movable);
@@ -19,29 +35,65 @@ ALevel0::ALevel0()
 	staticMeshParent->SetupAttachment(sceneComponent);
 	staticMeshParent->SetSimulatePhysics(true);
 
-	static ConstructorHelpers::FObjectFinder<UClass>FoundWidget(TEXT ("Class'/Game/Blueprints/UI/WB_WinScreen.WB_WinScreen_C'"));
-
-	if(FoundWidget.Succeeded()) levelCompleteScreenClass = FoundWidget.Object; 
-	
-	customGameMode = Cast<ACustomGameMode>(UGameplayStatics::GetGameMode(this));
+	ticTacClass = ATicTac::StaticClass();
+	bakedLayout = nullptr;
+	generatedBlockMesh = nullptr;
+	contactDamage = nullptr;
+	gameplayEvents = nullptr;
+	budgetManager = nullptr;
 }
 
 // Called when the game starts or when spawned
 void ALevel0::BeginPlay()
 {
 	Super::BeginPlay();
+
+	//Resolve the game mode once, constructors also run for the CDO where there is no world
+	services = UGameplayServicesSubsystem::Get(this);
+	customGameMode = services ? services->GetGameMode() : nullptr;
 	
+	const double loadStartTime = FPlatformTime::Seconds();
+	if(generatedBlockMesh)
+	{
+		CreateGeneratedBlocks();
+	}
 	GetComponents<UStaticMeshComponent>(staticMeshComponents);
-	GetComponents<UChildActorComponent>(emptyChildActors);
+
+	//The baked layout already has the turret markers, only walk the child actors when there is none
+	useBakedLayout = IsBakedLayoutValid();
+	if(!useBakedLayout)
+	{
+		GetComponents<UChildActorComponent>(emptyChildActors);
+	}
 	//FString num = FString::Printf(TEXT("Total child actors comps: %i"), emptyChildActors.Num());
 	
-	for(UStaticMeshComponent* meshComp : staticMeshComponents)
+	//Projectile hits are picked up by the contact callback, so block on block contacts need not notify at all
+	contactDamage = UContactDamageSubsystem::IsEnabled() ? GetWorld()->GetSubsystem<UContactDamageSubsystem>() : nullptr;
+	gameplayEvents = UGameplayEventSubsystem::Get(this);
+	budgetManager = GetWorld()->GetSubsystem<UTowerBudgetManager>();
+	if(budgetManager) budgetManager->RegisterTower(this);
+	
+	staticMeshHealthMap.Reserve(staticMeshComponents.Num());
+	for(int32 index = 0; index < staticMeshComponents.Num(); index++)
 	{
-		staticMeshHealthMap.Add(meshComp, meshHealth);
+		UStaticMeshComponent* meshComp = staticMeshComponents[index];
+		staticMeshHealthMap.Add(meshComp, useBakedLayout ? bakedLayout->meshHealth[index] : static_cast<int>(meshHealth));
 
-		//Enable notify collisions
-		meshComp->SetNotifyRigidBodyCollision(true); //Again, very important wee line
+		ARCollision::ConfigureBlock(meshComp);
+		if(contactDamage)
+		{
+			meshComp->SetNotifyRigidBodyCollision(false);
+			contactDamage->RegisterBlock(this, meshComp);
+		}
+		else
+		{
+			//Enable notify collisions
+			meshComp->SetNotifyRigidBodyCollision(true); //Again, very important wee line
+		}
 	}
+
+	UE_LOG(LogTemp, Log, TEXT("Level %i: set up %i blocks from %s in %.3f ms"), levelID, staticMeshComponents.Num(),
+		useBakedLayout ? TEXT("baked layout") : TEXT("components"), (FPlatformTime::Seconds() - loadStartTime) * 1000.0);
 	
 	// Log the number of static mesh components found
 	//GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Yellow, num);
@@ -49,34 +101,156 @@ void ALevel0::BeginPlay()
 	//SpawnTicTacs();
 }
 
+void ALevel0::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(budgetManager) budgetManager->UnregisterTower(this);
+	
+	if(contactDamage)
+	{
+		for(UStaticMeshComponent* meshComp : staticMeshComponents)
+		{
+			contactDamage->UnregisterBlock(meshComp);
+		}
+	}
+
+	//The tic tacs are owned by the level, a destroyed level hands them back to the pool
+	if(EndPlayReason == EEndPlayReason::Destroyed)
+	{
+		UGameplayActorPool* actorPool = customGameMode ? customGameMode->GetActorPool() : nullptr;
+		for(const FSpawnedTurret& turret : turrets)
+		{
+			ATicTac* ticTac = turret.ticTac.Get();
+			if(!ticTac) continue;
+			
+			if(actorPool) actorPool->Release(ticTac);
+			else ticTac->Destroy();
+		}
+		turrets.Reset();
+	}
+	
+	Super::EndPlay(EndPlayReason);
+}
+
 void ALevel0::SpawnTicTacs()
 {
+	TArray<FTransform, TInlineAllocator<16>> spawnTransforms;
+
+	if(useBakedLayout)
+	{
+		//Baked markers are relative to the mesh parent so they follow the scale the level was given
+		const FTransform parentTransform = staticMeshParent->GetComponentTransform();
+		spawnTransforms.Reserve(bakedLayout->turretTransforms.Num());
+		
+		for(const FTransform& marker : bakedLayout->turretTransforms)
+		{
+			spawnTransforms.Emplace(FRotator::ZeroRotator, parentTransform.TransformPosition(marker.GetLocation()));
+		}
+
+		SpawnTicTacsAt(spawnTransforms);
+		return;
+	}
+	
+	spawnTransforms.Reserve(emptyChildActors.Num());
+	
 	for(UChildActorComponent* emptyActor : emptyChildActors)
 	{
 		if(emptyActor)
 		{
-			//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, FString::Printf(TEXT("Spawning tic tac!!!!!")));
-			
-			//Spawn the tic tacs from here
-			FVector loc = emptyActor->GetComponentLocation();
-			FVector worldLoc = emptyActor->GetComponentTransform().TransformPosition(loc);
-			
-			ATicTac* tictac =  GetWorld()->SpawnActor<ATicTac>(ATicTac::StaticClass(), loc, FRotator::ZeroRotator);
+			//Spawn the tic tacs at the marker location
+			spawnTransforms.Emplace(FRotator::ZeroRotator, emptyActor->GetComponentLocation());
+		}
+	}
+
+	SpawnTicTacsAt(spawnTransforms);
+}
 
-			//Attach the tictac to the static mesh parent for correct positioning
-			tictac->AttachToComponent(staticMeshParent, FAttachmentTransformRules::KeepRelativeTransform);
+//Stress scenario, fills a grid across the top of the tower with extra tic tacs
+void ALevel0::SpawnStressTicTacs(int32 count)
+{
+	if(count <= 0) return;
+	
+	const FBox bounds = GetComponentsBoundingBox();
+	const int32 gridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(count)));
+	const FVector extent = bounds.GetSize();
 
-			//Set the position again here
-			tictac->SetActorLocation(loc);
-			tictac->SetPhysicsSimulation(true);
+	TArray<FTransform> spawnTransforms;
+	spawnTransforms.Reserve(count);
+	
+	for(int32 index = 0; index < count; index++)
+	{
+		const float u = (index % gridSize + 0.5f) / gridSize;
+		const float v = (index / gridSize + 0.5f) / gridSize;
+		const FVector location(bounds.Min.X + extent.X * u, bounds.Min.Y + extent.Y * v, bounds.Max.Z + 1.f);
+		spawnTransforms.Emplace(FRotator::ZeroRotator, location);
+	}
+
+	SpawnTicTacsAt(spawnTransforms);
+}
+
+void ALevel0::SpawnTicTacsAt(TArrayView<const FTransform> spawnTransforms)
+{
+	const double spawnStartTime = FPlatformTime::Seconds();
+	UClass* spawnClass = ticTacClass ? ticTacClass.Get() : ATicTac::StaticClass();
+
+	FActorSpawnParameters spawnInfo;
+	spawnInfo.Owner = this;
+	spawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	spawnInfo.bDeferConstruction = true;
+
+	UGameplayActorPool* actorPool = customGameMode ? customGameMode->GetActorPool() : nullptr;
+	const FTransform parentTransform = staticMeshParent->GetComponentTransform();
+
+	//First pass takes parked tic tacs from the pool and defers construction of the rest, so each tic tac is placed
+	//and attached once, before it is registered and ticking
+	TArray<TPair<ATicTac*, FTransform>, TInlineAllocator<16>> pendingTicTacs;
+	TArray<ATicTac*, TInlineAllocator<16>> placedTicTacs;
+	pendingTicTacs.Reserve(spawnTransforms.Num());
+	placedTicTacs.Reserve(spawnTransforms.Num());
+	
+	for(const FTransform& spawnTF : spawnTransforms)
+	{
+		if(ATicTac* pooled = actorPool ? Cast<ATicTac>(actorPool->Acquire(spawnClass, spawnTF)) : nullptr)
+		{
+			//Unparking turned physics on, it stays off until the whole batch is attached
+			pooled->SetPhysicsSimulation(false);
+			pooled->SetOwner(this);
+			pooled->AttachToComponent(staticMeshParent, FAttachmentTransformRules::KeepWorldTransform);
+			turrets.Add({ pooled, spawnTF.GetRelativeTransform(parentTransform) });
+			placedTicTacs.Add(pooled);
+			continue;
 		}
+		
+		//Spawn with the final transform
+		ATicTac* tictac = GetWorld()->SpawnActor<ATicTac>(spawnClass, spawnTF, spawnInfo);
+		if(!tictac) continue;
+
+		//Attach the tictac to the static mesh parent for correct positioning
+		tictac->AttachToComponent(staticMeshParent, FAttachmentTransformRules::KeepWorldTransform);
+		pendingTicTacs.Emplace(tictac, spawnTF);
+	}
+
+	//Second pass finishes the whole batch and only then enables physics
+	for(const TPair<ATicTac*, FTransform>& pending : pendingTicTacs)
+	{
+		pending.Key->FinishSpawning(pending.Value);
+		turrets.Add({ pending.Key, pending.Value.GetRelativeTransform(parentTransform) });
+		placedTicTacs.Add(pending.Key);
 	}
+	
+	for(ATicTac* tictac : placedTicTacs)
+	{
+		tictac->SetPhysicsSimulation(true);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Level %i: placed %i tic tacs (%i spawned) in %.3f ms"), levelID, placedTicTacs.Num(), pendingTicTacs.Num(),
+		(FPlatformTime::Seconds() - spawnStartTime) * 1000.0);
 }
 
 
 // Called every frame
 void ALevel0::Tick(float DeltaTime)
 {
+	AR_SCOPED_STAT(LevelTick);
 	Super::Tick(DeltaTime);
 
 	// Making sure the actor remains on the ARPin that has been found.
@@ -101,14 +275,35 @@ void ALevel0::Tick(float DeltaTime)
 		}
 	}
 
-	TArray<UStaticMeshComponent*> compsToRemove;
-	// Check the speed of static mesh components
-	for (const auto& meshEntry : staticMeshHealthMap)
+	INC_DWORD_STAT_BY(STAT_AR_ActiveBlocks, activeBlocks.Num());
+	INC_DWORD_STAT_BY(STAT_AR_Blocks, staticMeshHealthMap.Num());
+
+	//Work queued by earlier checks still drains on frames where the physics has not stepped
+	DrainPendingWork();
+
+	//With async physics nothing can have moved unless the physics has stepped since the last check
+	if(bAsyncPhysicsTickEnabled)
 	{
-		UStaticMeshComponent* meshComp = meshEntry.Key;
+		const uint32 steps = physicsSteps.load();
+		if(steps == checkedPhysicsSteps) return;
+		checkedPhysicsSteps = steps;
+	}
 
+	//With lazy physics the support graph decides what has fallen, a resting tower is never polled
+	if(lazyPhysics)
+	{
+		UpdateSupport();
+		return;
+	}
+
+	//Frame scratch, popped when the mark goes out of scope
+	FMemMark memMark(FMemStack::Get());
+	TArray<UStaticMeshComponent*, TMemStackAllocator<>> compsToRemove;
+	// Check the speed of static mesh components
+	for (UStaticMeshComponent* meshComp : staticMeshComponents)
+	{
 		// Ensure the mesh component is valid and simulating physics
-		if (meshComp && meshComp->IsSimulatingPhysics())
+		if (meshComp && meshComp->IsSimulatingPhysics() && staticMeshHealthMap.Contains(meshComp))
 		{
 			FVector currentVelocity = meshComp->GetComponentVelocity();
 
@@ -118,24 +313,442 @@ void ALevel0::Tick(float DeltaTime)
 			{
 				// Destroy the static mesh component
 				compsToRemove.Add(meshComp);
-				staticMeshHealthMap.Remove(meshComp);
 			}
 		}
 	}
 
 	for(UStaticMeshComponent* component : compsToRemove)
 	{
-		component->DestroyComponent();
+		QueueRemoval(component);
+	}
+
+}
+
+//Physics thread, the removals themselves stay on the game thread since they destroy components
+void ALevel0::AsyncPhysicsTickActor(float DeltaTime, float SimTime)
+{
+	Super::AsyncPhysicsTickActor(DeltaTime, SimTime);
+	physicsSteps.fetch_add(1);
+}
+
+uint32 ALevel0::ComputeStateHash() const
+{
+	//Positions are quantised to a millimetre in level space so float noise below that does not change the hash
+	const FTransform levelTransform = GetActorTransform();
+	uint32 hash = GetTypeHash(staticMeshComponents.Num());
+	
+	for(UStaticMeshComponent* meshComp : staticMeshComponents)
+	{
+		const FVector local = levelTransform.InverseTransformPosition(meshComp->GetComponentLocation()) * 10.f;
+		const FIntVector quantised(FMath::RoundToInt(local.X), FMath::RoundToInt(local.Y), FMath::RoundToInt(local.Z));
+		const int* health = staticMeshHealthMap.Find(meshComp);
+		
+		hash = HashCombine(hash, GetTypeHash(quantised));
+		hash = HashCombine(hash, GetTypeHash(health ? *health : 0));
+	}
+	return hash;
+}
+
+//Blocks that have moved away from where they rested have fallen off, everything the support graph
+//finds hanging after removals is released as one cluster
+void ALevel0::UpdateSupport()
+{
+	AR_SCOPED_STAT(SupportUpdate);
+	const FTransform levelTransform = GetActorTransform();
+
+	FMemMark memMark(FMemStack::Get());
+	TArray<UStaticMeshComponent*, TMemStackAllocator<>> compsToRemove;
+	for(UStaticMeshComponent* meshComp : activeBlocks)
+	{
+		const int32* node = graphNodeIndices.Find(meshComp);
+		if(!node) continue;
+
+		const FVector restLocation = levelTransform.TransformPosition(graphRestLocations[*node]);
+		if(FVector::DistSquared(meshComp->GetComponentLocation(), restLocation) > graphDetachDistancesSq[*node])
+		{
+			compsToRemove.Add(meshComp);
+		}
+	}
+
+	for(UStaticMeshComponent* component : compsToRemove)
+	{
+		QueueRemoval(component);
 	}
 
+	if(!supportGraph.IsDirty()) return;
+
+	supportGraph.CollectUnsupported(unsupportedScratch);
+	for(int32 node : unsupportedScratch)
+	{
+		QueueActivation(graphBlocks[node]);
+	}
+	INC_DWORD_STAT_BY(STAT_AR_BlocksReleased, unsupportedScratch.Num());
+}
+
+//Removes a destroyed block and wakes up anything it was touching, since their support may be gone
+void ALevel0::RemoveBlock(UStaticMeshComponent* meshComp)
+{
+	staticMeshHealthMap.Remove(meshComp);
+	staticMeshComponents.RemoveSingleSwap(meshComp, false);
+	activeBlocks.Remove(meshComp);
+
+	if(const int32* node = graphNodeIndices.Find(meshComp))
+	{
+		const int32 removedNode = *node;
+		for(int32 neighbour : supportGraph.GetNeighbours(removedNode))
+		{
+			if(!supportGraph.IsRemoved(neighbour))
+			{
+				QueueActivation(graphBlocks[neighbour]);
+			}
+		}
+		
+		supportGraph.RemoveNode(removedNode);
+		graphNodeIndices.Remove(meshComp);
+	}
+
+	if(contactDamage) contactDamage->UnregisterBlock(meshComp);
+
+	//Retired rather than destroyed so a restart can bring the block back from the snapshot
+	meshComp->SetSimulatePhysics(false);
+	meshComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	meshComp->SetVisibility(false);
+}
+
+//Without a budget manager (the platform, or a world that has none) the work is done straight away
+void ALevel0::QueueActivation(UStaticMeshComponent* meshComp)
+{
+	if(!budgetManager)
+	{
+		ActivateBlock(meshComp);
+		return;
+	}
+	if(activeBlocks.Contains(meshComp)) return;
+
+	bool alreadyQueued = false;
+	queuedActivations.Add(meshComp, &alreadyQueued);
+	if(!alreadyQueued) pendingActivations.Add(meshComp);
+}
+
+//A fast block stays fast for a few frames, so the same block can be found again while it waits
+void ALevel0::QueueRemoval(UStaticMeshComponent* meshComp)
+{
+	if(!budgetManager)
+	{
+		RemoveBlock(meshComp);
+		return;
+	}
+	bool alreadyQueued = false;
+	queuedRemovals.Add(meshComp, &alreadyQueued);
+	if(!alreadyQueued) pendingRemovals.Add(meshComp);
+}
+
+void ALevel0::DrainPendingWork()
+{
+	if(pendingRemovals.Num() > 0)
+	{
+		//Blocks already removed by damage in the meantime are skipped
+		const int32 count = FMath::Min(pendingRemovals.Num(), budgetManager->GetRemovalBudget(this));
+		for(int32 index = 0; index < count; index++)
+		{
+			UStaticMeshComponent* meshComp = pendingRemovals[index];
+			queuedRemovals.Remove(meshComp);
+			if(staticMeshHealthMap.Contains(meshComp)) RemoveBlock(meshComp);
+		}
+		pendingRemovals.RemoveAt(0, count, false);
+	}
+
+	//Removals above queue more activations, they wait for the next frame's budget
+	if(pendingActivations.Num() > 0)
+	{
+		const int32 count = FMath::Min(pendingActivations.Num(), budgetManager->GetActivationBudget(this));
+		for(int32 index = 0; index < count; index++)
+		{
+			UStaticMeshComponent* meshComp = pendingActivations[index];
+			queuedActivations.Remove(meshComp);
+			if(staticMeshHealthMap.Contains(meshComp)) ActivateBlock(meshComp);
+		}
+		pendingActivations.RemoveAt(0, count, false);
+	}
+}
+
+//Built once the level has been scaled, adjacency does not change when the tower is moved afterwards
+void ALevel0::BuildSupportGraph()
+{
+	const double buildStartTime = FPlatformTime::Seconds();
+	const FTransform levelTransform = GetActorTransform();
+
+	graphBlocks.Reset();
+	graphRestLocations.Reset();
+	graphDetachDistancesSq.Reset();
+	graphNodeIndices.Reset();
+
+	TArray<FBox> blockBounds;
+	blockBounds.Reserve(useBakedLayout ? 0 : staticMeshComponents.Num());
+	graphBlocks.Reserve(staticMeshComponents.Num());
+	float smallestExtent = TNumericLimits<float>::Max();
+	
+	for(UStaticMeshComponent* meshComp : staticMeshComponents)
+	{
+		if(meshComp == staticMeshParent) continue;
+
+		const FBox bounds = meshComp->Bounds.GetBox();
+		const float minExtent = bounds.GetExtent().GetMin();
+		smallestExtent = FMath::Min(smallestExtent, minExtent);
+
+		graphNodeIndices.Add(meshComp, graphBlocks.Num());
+		graphBlocks.Add(meshComp);
+		graphRestLocations.Add(levelTransform.InverseTransformPosition(meshComp->GetComponentLocation()));
+		
+		//A block counts as fallen off once it has moved by more than half its size
+		graphDetachDistancesSq.Add(FMath::Square(minExtent));
+		if(!useBakedLayout) blockBounds.Add(bounds);
+	}
+
+	//The baked adjacency skips the broad phase, it was checked against the components in BeginPlay
+	if(useBakedLayout)
+	{
+		supportGraph.BuildFromAdjacency(bakedLayout->neighbourOffsets, bakedLayout->neighbourIndices, bakedLayout->grounded);
+	}
+	else
+	{
+		const float contactTolerance = blockBounds.Num() > 0 ? smallestExtent * BlockContactTolerance : 0.f;
+		supportGraph.Build(blockBounds, contactTolerance);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Level %i: built support graph for %i blocks from %s in %.3f ms"), levelID, graphBlocks.Num(),
+		useBakedLayout ? TEXT("baked adjacency") : TEXT("bounds"), (FPlatformTime::Seconds() - buildStartTime) * 1000.0);
+}
+
+void ALevel0::CaptureSnapshot()
+{
+	snapshotBlocks = staticMeshComponents;
+	snapshotParents.Reset(snapshotBlocks.Num());
+	snapshotTransforms.Reset(snapshotBlocks.Num());
+	snapshotHealth.Reset(snapshotBlocks.Num());
+	
+	for(UStaticMeshComponent* meshComp : snapshotBlocks)
+	{
+		snapshotParents.Add(meshComp->GetAttachParent());
+		snapshotTransforms.Add(meshComp->GetRelativeTransform());
+		snapshotHealth.Add(staticMeshHealthMap.FindRef(meshComp));
+	}
+}
+
+void ALevel0::RestoreSnapshot()
+{
+	const double restoreStartTime = FPlatformTime::Seconds();
+	
+	staticMeshComponents = snapshotBlocks;
+	staticMeshHealthMap.Reset();
+	activeBlocks.Reset();
+	
+	for(int32 index = 0; index < snapshotBlocks.Num(); index++)
+	{
+		UStaticMeshComponent* meshComp = snapshotBlocks[index];
+		staticMeshHealthMap.Add(meshComp, snapshotHealth[index]);
+		if(meshComp == staticMeshParent) continue;
+
+		//Teleport while kinematic so the body comes back at rest
+		meshComp->SetSimulatePhysics(false);
+		USceneComponent* parent = snapshotParents[index];
+		if(parent && meshComp->GetAttachParent() != parent)
+		{
+			meshComp->AttachToComponent(parent, FAttachmentTransformRules::KeepRelativeTransform);
+		}
+		meshComp->SetRelativeTransform(snapshotTransforms[index], false, nullptr, ETeleportType::ResetPhysics);
+		meshComp->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		meshComp->SetVisibility(true);
+		if(!lazyPhysics) meshComp->SetSimulatePhysics(true);
+		if(contactDamage) contactDamage->RegisterBlock(this, meshComp);
+	}
+
+	//Graph nodes keep their indices, only the removals are undone
+	supportGraph.RestoreAll();
+	graphNodeIndices.Reset();
+	for(int32 node = 0; node < graphBlocks.Num(); node++)
+	{
+		graphNodeIndices.Add(graphBlocks[node], node);
+	}
+	levelCleared = false;
+	checkedPhysicsSteps = physicsSteps.load();
+	pendingActivations.Reset();
+	pendingRemovals.Reset();
+	queuedActivations.Reset();
+	queuedRemovals.Reset();
+
+	//Standing tic tacs are moved back, the ones knocked off are placed again from the pool
+	const FTransform parentTransform = staticMeshParent->GetComponentTransform();
+	TArray<FTransform, TInlineAllocator<16>> respawnTransforms;
+	for(int32 index = turrets.Num() - 1; index >= 0; index--)
+	{
+		const FTransform spawnTF = turrets[index].relativeTransform * parentTransform;
+		if(ATicTac* ticTac = turrets[index].ticTac.Get())
+		{
+			ticTac->SetPhysicsSimulation(false);
+			ticTac->SetActorTransform(spawnTF, false, nullptr, ETeleportType::ResetPhysics);
+			ticTac->SetParked(false);
+			continue;
+		}
+		
+		respawnTransforms.Add(spawnTF);
+		turrets.RemoveAtSwap(index, 1, false);
+	}
+	SpawnTicTacsAt(respawnTransforms);
+
+	UE_LOG(LogTemp, Log, TEXT("Level %i: restored %i blocks and %i tic tacs (%i respawned) in %.3f ms"), levelID, snapshotBlocks.Num(),
+		turrets.Num(), respawnTransforms.Num(), (FPlatformTime::Seconds() - restoreStartTime) * 1000.0);
+}
+
+//A parked tower stops every body it still simulates, RestoreSnapshot wakes them again before it is shown
+void ALevel0::SetLevelActive(bool active)
+{
+	if(!active)
+	{
+		SetPhysicsSimulation(false);
+		activeBlocks.Reset();
+		pendingActivations.Reset();
+		pendingRemovals.Reset();
+		queuedActivations.Reset();
+		queuedRemovals.Reset();
+	}
+	
+	SetActorHiddenInGame(!active);
+	SetActorEnableCollision(active);
+	SetActorTickEnabled(active);
+
+	for(const FSpawnedTurret& turret : turrets)
+	{
+		if(ATicTac* ticTac = turret.ticTac.Get()) ticTac->SetParked(!active);
+	}
+}
+
+void ALevel0::SetBakedLayout(ULevelLayoutData* layout)
+{
+	bakedLayout = layout;
+}
+
+void ALevel0::SetGeneratedLayout(ULevelLayoutData* layout, UStaticMesh* blockMesh)
+{
+	bakedLayout = layout;
+	generatedBlockMesh = blockMesh;
+}
+
+//Blocks are named after the layout entries so the usual baked layout check matches them up in BeginPlay
+void ALevel0::CreateGeneratedBlocks()
+{
+	if(!bakedLayout) return;
+
+	//The blocks rest on the platform, the mesh parent is only the frame they are placed in
+	staticMeshParent->SetSimulatePhysics(false);
+	
+	const int32 blockCount = bakedLayout->blockTransforms.Num();
+	for(int32 block = 0; block < blockCount && bakedLayout->meshNames.IsValidIndex(block + 1); block++)
+	{
+		UStaticMeshComponent* meshComp = NewObject<UStaticMeshComponent>(this, bakedLayout->meshNames[block + 1]);
+		meshComp->SetMobility(EComponentMobility::Movable);
+		meshComp->SetStaticMesh(generatedBlockMesh);
+		meshComp->SetupAttachment(staticMeshParent);
+		meshComp->SetRelativeTransform(bakedLayout->blockTransforms[block]);
+		meshComp->RegisterComponent();
+		AddInstanceComponent(meshComp);
+	}
+}
+
+//A stale asset (blocks added or renamed since the bake) falls back to discovering everything at runtime
+bool ALevel0::IsBakedLayoutValid() const
+{
+	if(!bakedLayout) return false;
+
+	const int32 meshCount = staticMeshComponents.Num();
+	const int32 blockCount = bakedLayout->blockTransforms.Num();
+	bool valid = bakedLayout->meshNames.Num() == meshCount
+		&& bakedLayout->meshHealth.Num() == meshCount
+		&& blockCount == meshCount - 1
+		&& bakedLayout->neighbourOffsets.Num() == blockCount + 1
+		&& bakedLayout->grounded.Num() == blockCount;
+
+	for(int32 index = 0; valid && index < meshCount; index++)
+	{
+		valid = staticMeshComponents[index]->GetFName() == bakedLayout->meshNames[index];
+	}
+
+	if(!valid)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Level %i: baked layout %s does not match the level, rerun the BakeLevelLayouts commandlet"),
+			levelID, *bakedLayout->GetName());
+	}
+	return valid;
+}
+
+#if WITH_EDITOR
+void ALevel0::BakeLayout(ULevelLayoutData* layout)
+{
+	TArray<UStaticMeshComponent*> meshComps;
+	GetComponents<UStaticMeshComponent>(meshComps);
+	TArray<UChildActorComponent*> markers;
+	GetComponents<UChildActorComponent>(markers);
+
+	layout->meshNames.Reset(meshComps.Num());
+	layout->meshHealth.Reset(meshComps.Num());
+	layout->blockTransforms.Reset(meshComps.Num());
+	layout->blockBounds.Reset(meshComps.Num());
+	layout->turretTransforms.Reset(markers.Num());
+
+	//Same node order and contact tolerance as BuildSupportGraph, the bake happens unscaled at the origin
+	const FTransform parentTransform = staticMeshParent->GetComponentTransform();
+	float smallestExtent = TNumericLimits<float>::Max();
+	
+	for(UStaticMeshComponent* meshComp : meshComps)
+	{
+		layout->meshNames.Add(meshComp->GetFName());
+		layout->meshHealth.Add(static_cast<int32>(meshHealth));
+		if(meshComp == staticMeshParent) continue;
+
+		const FBox bounds = meshComp->Bounds.GetBox();
+		smallestExtent = FMath::Min(smallestExtent, bounds.GetExtent().GetMin());
+		layout->blockTransforms.Add(meshComp->GetComponentTransform().GetRelativeTransform(parentTransform));
+		layout->blockBounds.Add(bounds);
+	}
+
+	for(UChildActorComponent* marker : markers)
+	{
+		if(marker)
+		{
+			layout->turretTransforms.Emplace(parentTransform.InverseTransformPosition(marker->GetComponentLocation()));
+		}
+	}
+
+	FBlockSupportGraph graph;
+	const float contactTolerance = layout->blockBounds.Num() > 0 ? smallestExtent * BlockContactTolerance : 0.f;
+	graph.Build(layout->blockBounds, contactTolerance);
+	
+	layout->neighbourOffsets = graph.GetNeighbourOffsets();
+	layout->neighbourIndices = graph.GetNeighbourIndices();
+	layout->grounded = graph.GetGrounded();
+}
+#endif
+
+void ALevel0::GatherBlockBounds(TArray<FBox>& outBoxes, TArray<UStaticMeshComponent*>& outBlocks, float expandBy) const
+{
+	outBoxes.Reserve(outBoxes.Num() + staticMeshHealthMap.Num());
+	outBlocks.Reserve(outBlocks.Num() + staticMeshHealthMap.Num());
+	for(const auto& entry : staticMeshHealthMap)
+	{
+		if(!entry.Key) continue;
+		outBoxes.Add(entry.Key->Bounds.GetBox().ExpandBy(expandBy));
+		outBlocks.Add(entry.Key);
+	}
 }
 
 void ALevel0::ItemDrop()
 {
+	AR_SCOPED_STAT(ItemDrop);
 	/*This is where there will be a chance for dropping an ammo object when the health of a
 	 * static mesh reaches zero
 	 */
-	TArray<UStaticMeshComponent*> compsToRemove;
+	FMemMark memMark(FMemStack::Get());
+	TArray<UStaticMeshComponent*, TMemStackAllocator<>> compsToRemove;
 	
 	for(auto& meshEntry : staticMeshHealthMap)
 	{
@@ -147,72 +760,95 @@ void ALevel0::ItemDrop()
 		{
 			//Add to array for removal after destruction of the component
 			compsToRemove.Add(meshComp);
-			staticMeshHealthMap.Remove(meshComp);
 			
-			//If this mesh health is below or equal to 0 then destroy it
-			const int dropChance = FMath::RandRange(0, dropRate);
-			if(dropChance <= dropRate)
+			//If this mesh health is below or equal to 0 then destroy it, dropRate is the percentage chance of a drop
+			const int dropChance = FMath::RandRange(1, 100);
+			if(dropChance <= dropRate && customGameMode)
 			{
-				//Spawn the object here
-				// FString num = FString::Printf(TEXT("Total meshes: %i"), staticMeshHealthMap.Num());
-				// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, num);
-
+				//Queue the drop, the pool spawns a few per frame and caps how many are alive
 				FVector location = meshComp->GetComponentLocation();
 				FRotator rotation = meshComp->GetComponentRotation();
 				
-				AThePlayer* playerRef = customGameMode->GetPlayerReference();
-				playerRef->SpawnItemDrop(location, rotation);
+				customGameMode->GetItemDropPool()->RequestDrop(location, rotation);
 			}
 		}
 	}
 
 	for(UStaticMeshComponent* component : compsToRemove)
 	{
-		component->DestroyComponent();
+		RemoveBlock(component);
 	}
 
 	//End level here
 	//If the player destroys all blocks in a level switch to win screen. Once here, player goes back to level select window.
-	if(staticMeshHealthMap.Num() <= 1)
+	if(staticMeshHealthMap.Num() <= 1 && !levelCleared)
 	{
-		//Create new widget
-		levelCompleteScreen = CreateWidget<UWidgetBase>(GetWorld(), levelCompleteScreenClass);
+		levelCleared = true;
+		if(gameplayEvents)
+		{
+			gameplayEvents->LevelCleared(this);
+		}
+		else
+		{
+			CompleteLevel();
+		}
+	}
+}
 
-		levelCompleteScreen->AddToViewport();
+void ALevel0::CompleteLevel()
+{
+	//With other towers still standing only this one is parked, the round is won with the last tower
+	if(customGameMode) customGameMode->ResetLevel(this);
+	SetLevelActive(false);
+	if(!customGameMode || customGameMode->GetNumTowers() > 0) return;
+	
+	//Show the prebuilt win screen
+	const double showStartTime = FPlatformTime::Seconds();
+	customGameMode->GetUIManager()->ShowScreen(EGameScreen::Win);
+	UE_LOG(LogTemp, Log, TEXT("Level %i complete: win screen shown in %.3f ms"), levelID, (FPlatformTime::Seconds() - showStartTime) * 1000.0);
 
-		//Set the level is spawned in the player class to false
-		AThePlayer* playerRef = customGameMode->GetPlayerReference();
+	//Set the level is spawned in the player class to false
+	if(AThePlayer* playerRef = services ? services->GetPlayer() : nullptr)
+	{
 		playerRef->SetLevelSpawned(false);
 		playerRef->EnableThrow(false);
 		playerRef->ResetScore();
-
-		HelloARManager = customGameMode->GetHelloARManager();
-		HelloARManager->EnablePlaneUpdate(false);
-		customGameMode->ResetLevel();
-		Destroy();
 	}
+
+	customGameMode->GetItemDropPool()->ReportStats();
+	customGameMode->GetActorPool()->ReportStats();
+
+	HelloARManager = services ? services->GetARManager() : nullptr;
+	if(HelloARManager) HelloARManager->EnablePlaneUpdate(false);
 }
 
 void ALevel0::DecrementHealth(UStaticMeshComponent* meshComp, int damage)
 {
-	if(isPlatform) return;
-	//Decrement the health when a projectile hits a static mesh
-	for(const auto& entry : staticMeshHealthMap)
+	AR_SCOPED_STAT(DecrementHealth);
+	if(isPlatform || !staticMeshHealthMap.Contains(meshComp)) return;
+
+	//Being hit is what wakes a kinematic block up, that has to happen now for the physics response
+	ActivateBlock(meshComp);
+	
+	//Health, drops and the clear check are coalesced with every other hit this frame
+	if(gameplayEvents)
 	{
-		if(entry.Key == meshComp)
-		{
-			//Decrement the health of the mesh
-			int& health = staticMeshHealthMap[meshComp];
-			health -= damage;
-			// GEngine->AddOnScreenDebugMessage(-1, 2, FColor::Yellow, (TEXT("Decrementing health...")));
-			break;
-		}
+		gameplayEvents->DamageBlock(meshComp, damage);
+		return;
 	}
-	
-	//Check if the health of a static mesh has reached zero
+
+	ApplyDamage(meshComp, damage);
 	ItemDrop();
 }
 
+void ALevel0::ApplyDamage(UStaticMeshComponent* meshComp, int damage)
+{
+	if(int* health = staticMeshHealthMap.Find(meshComp))
+	{
+		*health -= damage;
+	}
+}
+
 
 /*Setters*/
 void ALevel0::SetPhysicsSimulation(bool val)
@@ -227,6 +863,41 @@ void ALevel0::SetPhysicsSimulation(bool val)
 	}
 }
 
+//Start every block kinematic, blocks are switched to simulating when hit, when their support goes or by explosions
+void ALevel0::EnableLazyPhysics()
+{
+	lazyPhysics = true;
+	activeBlocks.Reset();
+	SetPhysicsSimulation(false);
+	BuildSupportGraph();
+}
+
+void ALevel0::ActivateBlock(UStaticMeshComponent* meshComp)
+{
+	if(!meshComp || meshComp == staticMeshParent) return;
+
+	bool alreadyActive = false;
+	activeBlocks.Add(meshComp, &alreadyActive);
+	if(alreadyActive) return;
+	
+	meshComp->SetSimulatePhysics(true);
+	meshComp->WakeAllRigidBodies();
+}
+
+void ALevel0::ActivateBlocksInRadius(const FVector& location, float radius)
+{
+	if(!lazyPhysics) return;
+
+	const float radiusSquared = radius * radius;
+	for(UStaticMeshComponent* meshComp : staticMeshComponents)
+	{
+		if(meshComp->Bounds.ComputeSquaredDistanceFromBoxToPoint(location) <= radiusSquared)
+		{
+			ActivateBlock(meshComp);
+		}
+	}
+}
+
 //Allows for changing the mobility of an object instance inheriting from this class
 void ALevel0::SetObjectMobility(EComponentMobility::Type mobility)
 {
@@ -238,9 +909,57 @@ void ALevel0::SetObjectScale(const FVector& scale)
 	staticMeshParent->SetWorldScale3D(scale);
 }
 
+//The platform is the only level that wants hits, tic tacs landing on it are removed. The tic tacs themselves
+//do not notify so the ones resting on a tower generate no hit events at all
 void ALevel0::SetIsPlatform()
 {
 	isPlatform = true;
+
+	//The platform is never destroyed, it stays out of the tower budgets
+	if(budgetManager)
+	{
+		budgetManager->UnregisterTower(this);
+		budgetManager = nullptr;
+	}
+	
+	for(UStaticMeshComponent* meshComp : staticMeshComponents)
+	{
+		meshComp->SetNotifyRigidBodyCollision(true);
+	}
+}
+
+void ALevel0::NotifyHit(UPrimitiveComponent* comp, AActor* other, UPrimitiveComponent* otherComp, bool bSelfMoved,
+	FVector hitLocation, FVector hitNormal, FVector normalImpulse, const FHitResult& hit)
+{
+	Super::NotifyHit(comp, other, otherComp, bSelfMoved, hitLocation, hitNormal, normalImpulse, hit);
+	INC_DWORD_STAT(STAT_AR_HitEvents);
+	
+	if(!isPlatform || !otherComp || otherComp->GetCollisionObjectType() != ARCollision::Turret) return;
+	
+	if(ATicTac* ticTac = Cast<ATicTac>(other))
+	{
+		//The tower that placed the tic tac forgets it, so its restore puts a fresh one in that spot
+		if(ALevel0* ownerLevel = Cast<ALevel0>(ticTac->GetOwner()))
+		{
+			ownerLevel->ReleaseTicTac(ticTac);
+		}
+		else
+		{
+			ticTac->Destroy();
+		}
+	}
+}
+
+void ALevel0::ReleaseTicTac(ATicTac* ticTac)
+{
+	for(FSpawnedTurret& turret : turrets)
+	{
+		if(turret.ticTac.Get() == ticTac) turret.ticTac.Reset();
+	}
+
+	UGameplayActorPool* actorPool = customGameMode ? customGameMode->GetActorPool() : nullptr;
+	if(actorPool) actorPool->Release(ticTac);
+	else ticTac->Destroy();
 }
 
 /*Getters*/
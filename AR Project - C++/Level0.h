@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "BlockSupportGraph.h"
 #include "CustomGameMode.h"
 #include "GameFramework/Actor.h"
 #include "ItemDrop.h"
@@ -10,9 +11,15 @@
 #include "PhysicsEngine/PhysicsHandleComponent.h"
 #include "WidgetBase.h"
 #include "HelloARManager.h"
+#include <atomic>
 #include "Level0.generated.h"
 
 class UARPin;
+class UGameplayServicesSubsystem;
+class ULevelLayoutData;
+class UContactDamageSubsystem;
+class UGameplayEventSubsystem;
+class UTowerBudgetManager;
 
 UCLASS()
 class UE5_AR_API ALevel0 : public AActor
@@ -23,45 +30,154 @@ public:
 	// Sets default values for this actor's properties
 	ALevel0();
 	void SpawnTicTacs();
+	void SpawnStressTicTacs(int32 count);
 	void SetPhysicsSimulation(bool val);
+	void EnableLazyPhysics();
+	void ActivateBlock(UStaticMeshComponent* meshComp);
+	void ActivateBlocksInRadius(const FVector& location, float radius);
 	void SetObjectMobility(EComponentMobility::Type mobility);
 	void SetObjectScale(const FVector& scale);
 	void DecrementHealth(UStaticMeshComponent* meshComp, int damage);
+
+	//Called from the end of frame gameplay event pass with the damage a block took this frame
+	void ApplyDamage(UStaticMeshComponent* meshComp, int damage);
+	void ItemDrop();
+	void CompleteLevel();
 	
 	void SetIsPlatform();
 	bool GetIsPlatform();
+	const TSet<UStaticMeshComponent*>& GetActiveBlocks() const { return activeBlocks; }
+
+	//Blocks waiting to be woken or removed, drained each tick within the budgets of UTowerBudgetManager
+	int32 GetPendingWork() const { return pendingActivations.Num() + pendingRemovals.Num(); }
+
+	//Appends the world bounds of every block still standing, grown by expandBy, outBlocks[i] owns outBoxes[i]
+	void GatherBlockBounds(TArray<FBox>& outBoxes, TArray<UStaticMeshComponent*>& outBlocks, float expandBy = 0.f) const;
+
+	//Records the freshly spawned blocks, RestoreSnapshot later puts blocks and turrets back in place without respawning
+	void CaptureSnapshot();
+	bool HasSnapshot() const { return snapshotBlocks.Num() > 0; }
+	void RestoreSnapshot();
+
+	//A finished level is kept hidden and inactive so a retry can restore it instead of spawning the blueprint again
+	void SetLevelActive(bool active);
+
+	//Knocked off tic tacs go back to the pool and their spot is placed again on the next restore
+	void ReleaseTicTac(ATicTac* ticTac);
+
+	//Set between a deferred spawn and FinishSpawning, BeginPlay then loads the baked arrays instead of discovering them
+	void SetBakedLayout(ULevelLayoutData* layout);
+	bool IsUsingBakedLayout() const { return useBakedLayout; }
+
+	//Procedural towers have no blueprint components, BeginPlay creates one block per layout entry with blockMesh
+	void SetGeneratedLayout(ULevelLayoutData* layout, UStaticMesh* blockMesh);
+
+#if WITH_EDITOR
+	//Fills a layout asset from this level's components, used by the BakeLevelLayouts commandlet
+	void BakeLayout(ULevelLayoutData* layout);
+#endif
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
+	virtual void AsyncPhysicsTickActor(float DeltaTime, float SimTime) override;
+	virtual void NotifyHit(class UPrimitiveComponent* comp, AActor* other, UPrimitiveComponent* otherComp, bool bSelfMoved,
+		FVector hitLocation, FVector hitNormal, FVector normalImpulse, const FHitResult& hit) override;
+
+	//Hash of the remaining blocks and their health, the benchmark compares it across runs to check determinism
+	uint32 ComputeStateHash() const;
 
 	UARPin* PinComponent;
 
 	UPROPERTY(Category = "Level Properties", EditAnywhere, BlueprintReadWrite)
 	int levelID;
 
+	//Turret class spawned at each marker, levels can point this at a preconfigured tic tac blueprint
+	UPROPERTY(Category = "Level Properties", EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<ATicTac> ticTacClass;
+
 private:
-	void ItemDrop();
+	void SpawnTicTacsAt(TArrayView<const FTransform> spawnTransforms);
+	void RemoveBlock(UStaticMeshComponent* meshComp);
+	void QueueActivation(UStaticMeshComponent* meshComp);
+	void QueueRemoval(UStaticMeshComponent* meshComp);
+	void DrainPendingWork();
+	void BuildSupportGraph();
+	void UpdateSupport();
+	bool IsBakedLayoutValid() const;
+	void CreateGeneratedBlocks();
 	
+	UGameplayServicesSubsystem* services;
 	ACustomGameMode* customGameMode;
+
+	//Set when projectile hits on the blocks are resolved by the physics thread contact callback
+	UContactDamageSubsystem* contactDamage;
+
+	//Hits only queue their damage here, health, drops and the level clear are resolved once at the end of the frame
+	UGameplayEventSubsystem* gameplayEvents;
+
+	//Shares activations and removals between the towers in play, oldest queued block first
+	UTowerBudgetManager* budgetManager;
+	TArray<UStaticMeshComponent*> pendingActivations;
+	TArray<UStaticMeshComponent*> pendingRemovals;
+	TSet<UStaticMeshComponent*> queuedActivations; //Same blocks as the queues, so a block is only queued once
+	TSet<UStaticMeshComponent*> queuedRemovals;
 	
 	FVector initialScale = FVector(0.015f,0.015f, 0.015f);
 	USceneComponent* sceneComponent;
 	UStaticMeshComponent* staticMeshParent;
 	TArray<UStaticMeshComponent*> staticMeshComponents;
 	TMap<UStaticMeshComponent*, int> staticMeshHealthMap; //For storing mesh and health variables
+
+	//Blocks start kinematic and only the ones in here are simulating
+	TSet<UStaticMeshComponent*> activeBlocks;
+	bool lazyPhysics = false;
+
+	//Structural support, node i is graphBlocks[i] and its rest position in level space is graphRestLocations[i]
+	FBlockSupportGraph supportGraph;
+	TArray<UStaticMeshComponent*> graphBlocks;
+	TArray<FVector> graphRestLocations;
+	TArray<float> graphDetachDistancesSq;
+	TMap<UStaticMeshComponent*, int32> graphNodeIndices;
+	TArray<int32> unsupportedScratch; //Kept between updates so a collapse does not allocate
+
+	//Async physics mode, counted on the physics thread so the destruction checks only run after a physics step
+	std::atomic<uint32> physicsSteps{0};
+	uint32 checkedPhysicsSteps = 0;
 	
 	//Used for spawning the tic tacs at specific locations
 	TArray<UChildActorComponent*>emptyChildActors;
 
-	TSubclassOf<UWidgetBase> levelCompleteScreenClass;
-	UWidgetBase* levelCompleteScreen;
+	//Every tic tac spawned for this level with where it started relative to the mesh parent
+	struct FSpawnedTurret
+	{
+		TWeakObjectPtr<ATicTac> ticTac;
+		FTransform relativeTransform;
+	};
+	TArray<FSpawnedTurret> turrets;
+
+	//Initial state of every mesh component, removed blocks are only retired so these stay valid
+	TArray<UStaticMeshComponent*> snapshotBlocks;
+	TArray<USceneComponent*> snapshotParents; //Simulating blocks are detached, they are attached back here before their transform is restored
+	TArray<FTransform> snapshotTransforms;
+	TArray<int> snapshotHealth;
+
+	//Precomputed layout from the level's baked asset, only used if it still matches the blueprint's components
+	UPROPERTY()
+	ULevelLayoutData* bakedLayout;
+	bool useBakedLayout = false;
+
+	UPROPERTY()
+	UStaticMesh* generatedBlockMesh;
+
 	AHelloARManager* HelloARManager;
+	bool levelCleared = false;
 	
 	float meshHealth = 100.f;
-	int dropRate = 50;
+	int dropRate = 50; //Percentage chance of a destroyed block dropping an item
 	bool isPlatform = false;
 };
@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LevelLayoutData.h"
+
+#include "Misc/PackageName.h"
+
+FString ULevelLayoutData::GetBakedPackageName(const FString& levelName)
+{
+	return FString::Printf(TEXT("/Game/Blueprints/Levels/Baked/DA_%s"), *levelName);
+}
+
+FSoftObjectPath ULevelLayoutData::GetBakedAssetPath(const FString& levelName)
+{
+	const FString packageName = GetBakedPackageName(levelName);
+	return FSoftObjectPath(packageName + TEXT(".") + FPackageName::GetShortName(packageName));
+}
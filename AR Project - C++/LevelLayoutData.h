@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "LevelLayoutData.generated.h"
+
+/**
+ * Flat, precomputed description of a level blueprint produced by the BakeLevelLayouts commandlet.
+ * At runtime ALevel0 loads these arrays linearly instead of discovering its markers and building
+ * the health map and support graph from scratch.
+ */
+UCLASS(BlueprintType)
+class UE5_AR_API ULevelLayoutData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	//Mesh component names in GetComponents order, used to check the blueprint has not changed since baking
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<FName> meshNames;
+
+	//Initial health for each entry in meshNames
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<int32> meshHealth;
+
+	//Support graph nodes, the blocks are the mesh components other than the mesh parent, in order
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<FTransform> blockTransforms;
+
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<FBox> blockBounds;
+
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<int32> neighbourOffsets;
+
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<int32> neighbourIndices;
+
+	UPROPERTY(VisibleAnywhere, Category = "Blocks")
+	TArray<bool> grounded;
+
+	//Turret markers relative to the level's mesh parent
+	UPROPERTY(VisibleAnywhere, Category = "Turrets")
+	TArray<FTransform> turretTransforms;
+
+	//Where the baked asset for a level class lives, e.g. /Game/Blueprints/Levels/Baked/DA_BP_Level0
+	static FString GetBakedPackageName(const FString& levelName);
+	static FSoftObjectPath GetBakedAssetPath(const FString& levelName);
+};
@@ -0,0 +1,229 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProceduralTowerGenerator.h"
+
+#include "LevelLayoutData.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "UObject/Package.h"
+
+namespace ProceduralTowerGenerator
+{
+	//Each column draws from its own stream so the result does not depend on how the columns are split across threads
+	static FRandomStream ColumnStream(int32 seed, int32 column, uint32 purpose)
+	{
+		return FRandomStream(static_cast<int32>(HashCombine(HashCombine(GetTypeHash(seed), GetTypeHash(column)), purpose)));
+	}
+
+	void Generate(const FProceduralTowerParams& params, ULevelLayoutData* outLayout, bool singleThreaded)
+	{
+		check(outLayout);
+		const int32 blockCount = FMath::Max(params.targetBlocks, 1);
+		const EParallelForFlags parallelFlags = singleThreaded ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None;
+
+		//Roughly as tall as it is wide so the shape stays a tower from 10 to 10,000 blocks
+		const int32 meanHeight = FMath::Max(FMath::RoundToInt(FMath::Pow(static_cast<float>(blockCount), 1.f / 3.f) * 1.5f), 1);
+		const int32 columnTarget = FMath::DivideAndRoundUp(blockCount, meanHeight);
+		const int32 gridX = FMath::Max(FMath::CeilToInt(FMath::Sqrt(static_cast<float>(columnTarget))), 1);
+		const int32 gridY = FMath::DivideAndRoundUp(columnTarget, gridX);
+		const int32 columnCount = gridX * gridY;
+
+		//Column weights, then heights scaled so they add up to exactly the requested block count
+		TArray<float> weights;
+		weights.SetNumUninitialized(columnCount);
+		ParallelFor(columnCount, [&](int32 column)
+		{
+			FRandomStream random = ColumnStream(params.seed, column, 0);
+			weights[column] = FMath::Max(1.f + params.heightVariation * (2.f * random.FRand() - 1.f), 0.05f);
+		}, parallelFlags);
+
+		float totalWeight = 0.f;
+		for(float weight : weights) totalWeight += weight;
+
+		TArray<int32> heights;
+		heights.SetNumUninitialized(columnCount);
+		int32 assigned = 0;
+		for(int32 column = 0; column < columnCount; column++)
+		{
+			heights[column] = FMath::FloorToInt(blockCount * weights[column] / totalWeight);
+			assigned += heights[column];
+		}
+
+		//Rounding leaves a few blocks over, they go on the heaviest columns first
+		TArray<int32> byWeight;
+		byWeight.SetNumUninitialized(columnCount);
+		for(int32 column = 0; column < columnCount; column++) byWeight[column] = column;
+		byWeight.Sort([&weights](int32 a, int32 b) { return weights[a] > weights[b] || (weights[a] == weights[b] && a < b); });
+		for(int32 rank = 0; assigned < blockCount; rank = (rank + 1) % columnCount)
+		{
+			heights[byWeight[rank]]++;
+			assigned++;
+		}
+
+		//Block i of a column is node columnStarts[column] + i, bottom up
+		TArray<int32> columnStarts;
+		columnStarts.SetNumUninitialized(columnCount + 1);
+		columnStarts[0] = 0;
+		for(int32 column = 0; column < columnCount; column++)
+		{
+			columnStarts[column + 1] = columnStarts[column] + heights[column];
+		}
+
+		auto heightAt = [&](int32 x, int32 y)
+		{
+			return x >= 0 && x < gridX && y >= 0 && y < gridY ? heights[y * gridX + x] : 0;
+		};
+		static const FIntPoint lateralOffsets[] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+
+		//Mesh entries include the mesh parent at index 0, block entries do not
+		outLayout->meshNames.SetNum(blockCount + 1);
+		outLayout->meshHealth.Init(params.blockHealth, blockCount + 1);
+		outLayout->blockTransforms.SetNum(blockCount);
+		outLayout->blockBounds.SetNum(blockCount);
+		outLayout->grounded.SetNum(blockCount);
+		outLayout->neighbourOffsets.SetNum(blockCount + 1);
+		outLayout->meshNames[0] = TEXT("MeshParent");
+
+		//Placement and neighbour counts, the tower is centred on the mesh parent and stands on it
+		TArray<int32> neighbourCounts;
+		neighbourCounts.SetNumUninitialized(blockCount);
+		const FVector halfBlock = params.blockSize * 0.5f;
+		ParallelFor(columnCount, [&](int32 column)
+		{
+			const int32 x = column % gridX;
+			const int32 y = column / gridX;
+			const FVector columnOffset((x - (gridX - 1) * 0.5f) * params.blockSize.X, (y - (gridY - 1) * 0.5f) * params.blockSize.Y, 0.f);
+
+			for(int32 layer = 0; layer < heights[column]; layer++)
+			{
+				const int32 node = columnStarts[column] + layer;
+				const FVector location = columnOffset + FVector(0.f, 0.f, (layer + 0.5f) * params.blockSize.Z);
+
+				outLayout->meshNames[node + 1] = FName(BlockNamePrefix, node + 1);
+				outLayout->blockTransforms[node] = FTransform(location);
+				outLayout->blockBounds[node] = FBox(location - halfBlock, location + halfBlock);
+				outLayout->grounded[node] = layer == 0;
+
+				int32 count = (layer > 0 ? 1 : 0) + (layer + 1 < heights[column] ? 1 : 0);
+				for(const FIntPoint& offset : lateralOffsets)
+				{
+					count += heightAt(x + offset.X, y + offset.Y) > layer ? 1 : 0;
+				}
+				neighbourCounts[node] = count;
+			}
+		}, parallelFlags);
+
+		int32 neighbourTotal = 0;
+		for(int32 node = 0; node < blockCount; node++)
+		{
+			outLayout->neighbourOffsets[node] = neighbourTotal;
+			neighbourTotal += neighbourCounts[node];
+		}
+		outLayout->neighbourOffsets[blockCount] = neighbourTotal;
+		outLayout->neighbourIndices.SetNumUninitialized(neighbourTotal);
+
+		//Same order as the counts above, below, above, then the four sides
+		ParallelFor(columnCount, [&](int32 column)
+		{
+			const int32 x = column % gridX;
+			const int32 y = column / gridX;
+
+			for(int32 layer = 0; layer < heights[column]; layer++)
+			{
+				const int32 node = columnStarts[column] + layer;
+				int32 write = outLayout->neighbourOffsets[node];
+
+				if(layer > 0) outLayout->neighbourIndices[write++] = node - 1;
+				if(layer + 1 < heights[column]) outLayout->neighbourIndices[write++] = node + 1;
+				for(const FIntPoint& offset : lateralOffsets)
+				{
+					const int32 neighbourX = x + offset.X;
+					const int32 neighbourY = y + offset.Y;
+					if(heightAt(neighbourX, neighbourY) > layer)
+					{
+						outLayout->neighbourIndices[write++] = columnStarts[neighbourY * gridX + neighbourX] + layer;
+					}
+				}
+			}
+		}, parallelFlags);
+
+		//Turret markers sit on top of the chosen columns, relative to the mesh parent like the baked ones
+		outLayout->turretTransforms.Reset();
+		int32 tallestColumn = 0;
+		for(int32 column = 0; column < columnCount; column++)
+		{
+			if(heights[column] > heights[tallestColumn]) tallestColumn = column;
+			if(heights[column] == 0) continue;
+
+			FRandomStream random = ColumnStream(params.seed, column, 1);
+			if(random.FRand() < params.turretDensity)
+			{
+				const FVector top = outLayout->blockTransforms[columnStarts[column + 1] - 1].GetLocation() + FVector(0.f, 0.f, halfBlock.Z);
+				outLayout->turretTransforms.Emplace(top);
+			}
+		}
+		if(outLayout->turretTransforms.Num() == 0)
+		{
+			const FVector top = outLayout->blockTransforms[columnStarts[tallestColumn + 1] - 1].GetLocation() + FVector(0.f, 0.f, halfBlock.Z);
+			outLayout->turretTransforms.Emplace(top);
+		}
+	}
+}
+
+//Same adjacency, health and grounding exactly, transforms and bounds within tolerance since threads may round differently
+static bool LayoutsMatch(const ULevelLayoutData& a, const ULevelLayoutData& b, float tolerance)
+{
+	if(a.meshNames != b.meshNames || a.meshHealth != b.meshHealth || a.neighbourOffsets != b.neighbourOffsets
+		|| a.neighbourIndices != b.neighbourIndices || a.grounded != b.grounded
+		|| a.blockTransforms.Num() != b.blockTransforms.Num() || a.blockBounds.Num() != b.blockBounds.Num()
+		|| a.turretTransforms.Num() != b.turretTransforms.Num())
+	{
+		return false;
+	}
+
+	for(int32 index = 0; index < a.blockTransforms.Num(); index++)
+	{
+		if(!a.blockTransforms[index].Equals(b.blockTransforms[index], tolerance)) return false;
+	}
+	for(int32 index = 0; index < a.blockBounds.Num(); index++)
+	{
+		if(!a.blockBounds[index].Min.Equals(b.blockBounds[index].Min, tolerance) || !a.blockBounds[index].Max.Equals(b.blockBounds[index].Max, tolerance)) return false;
+	}
+	for(int32 index = 0; index < a.turretTransforms.Num(); index++)
+	{
+		if(!a.turretTransforms[index].Equals(b.turretTransforms[index], tolerance)) return false;
+	}
+	return true;
+}
+
+//Generates every preset single threaded and on the task graph, logs both times and checks they built the same tower
+static FAutoConsoleCommand ARTowerGeneratorBenchCommand(
+	TEXT("ar.Bench.TowerGenerator"),
+	TEXT("Generates each procedural tower preset serially and in parallel and logs the times. Usage: ar.Bench.TowerGenerator [seed, default 0]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& args)
+	{
+		FProceduralTowerParams params;
+		params.seed = args.Num() > 0 ? FCString::Atoi(*args[0]) : 0;
+
+		ULevelLayoutData* serialLayout = NewObject<ULevelLayoutData>(GetTransientPackage());
+		ULevelLayoutData* parallelLayout = NewObject<ULevelLayoutData>(GetTransientPackage());
+		for(int32 blockCount : ProceduralTowerGenerator::PresetBlockCounts)
+		{
+			params.targetBlocks = blockCount;
+
+			uint64 startCycles = FPlatformTime::Cycles64();
+			ProceduralTowerGenerator::Generate(params, serialLayout, true);
+			const double serialMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+			startCycles = FPlatformTime::Cycles64();
+			ProceduralTowerGenerator::Generate(params, parallelLayout, false);
+			const double parallelMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles);
+
+			const bool matches = LayoutsMatch(*serialLayout, *parallelLayout, KINDA_SMALL_NUMBER);
+			UE_LOG(LogTemp, Display, TEXT("Tower generator: %i blocks, %i links, %i turrets, serial %.3f ms, parallel %.3f ms%s"),
+				blockCount, parallelLayout->neighbourIndices.Num(), parallelLayout->turretTransforms.Num(), serialMs, parallelMs,
+				matches ? TEXT("") : TEXT(", MISMATCH"));
+		}
+	}));
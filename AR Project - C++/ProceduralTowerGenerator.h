@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ULevelLayoutData;
+
+struct FProceduralTowerParams
+{
+	int32 seed = 0;
+	int32 targetBlocks = 100;
+
+	//Size of one block in level space, the engine cube is 100 units
+	FVector blockSize = FVector(100.f);
+
+	//Column heights vary by up to this fraction either side of the mean
+	float heightVariation = 0.5f;
+
+	//Fraction of the columns that get a turret marker on top, at least one column always does
+	float turretDensity = 0.1f;
+
+	int32 blockHealth = 100;
+};
+
+/**
+ * Builds ALevel0 layouts for benchmark scale towers: a grid of block columns with seeded heights and turret
+ * markers on top of some of the columns. The output is the same ULevelLayoutData the BakeLevelLayouts
+ * commandlet writes, entry 0 being the mesh parent, so the level loads it through the baked layout path.
+ * Columns are generated in parallel on the task graph, the same seed and block count always give the same tower.
+ */
+namespace ProceduralTowerGenerator
+{
+	//Preset block counts for the scaling benchmarks
+	inline constexpr int32 PresetBlockCounts[] = { 10, 100, 1000, 10000 };
+
+	//Block components the level creates are named like this, meshNames[i + 1] for block i
+	inline const TCHAR* BlockNamePrefix = TEXT("GeneratedBlock");
+
+	UE5_AR_API void Generate(const FProceduralTowerParams& params, ULevelLayoutData* outLayout, bool singleThreaded = false);
+}
@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileLauncher.h"
+
+namespace ProjectileLaunch
+{
+	FVector ClampLaunchVelocity(const FVector& releaseVelocity)
+	{
+		//Clamp the velocity of the player projectile forward and right motion (X,Y)
+		const FVector velocityScale = FVector(1.75f, 1.75f, 0.5f);
+		FVector velocity = releaseVelocity * velocityScale;
+
+		velocity.Z = FMath::Clamp(velocity.Z, 0.f, 150.f);
+		velocity.Y = FMath::Clamp(velocity.Y, -500.f, 500.f);
+		velocity.X = FMath::Clamp(velocity.X, -500.f, 500.f);
+		return velocity;
+	}
+}
@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BombProjectile.h"
+#include "GameplayActorPool.h"
+#include "GestureVelocityEstimator.h"
+#include "Projectile.h"
+#include "Engine/World.h"
+
+namespace ProjectileLaunch
+{
+	//Scales the release velocity and clamps it, forward and right (X,Y) are capped and the throw can never go downwards
+	UE5_AR_API FVector ClampLaunchVelocity(const FVector& releaseVelocity);
+}
+
+//Player projectile thrown on a regular touch
+struct FRegularProjectilePolicy
+{
+	using FProjectileClass = AProjectile;
+};
+
+//Player bomb, thrown once after the player picks bomb mode
+struct FBombProjectilePolicy
+{
+	using FProjectileClass = ABombProjectile;
+};
+
+/**
+ * Spawns, drags and launches the held projectiles of one policy, keyed by the finger holding each one so several
+ * touches can each hold and throw their own projectile at the same time. Every drag sample feeds the finger's
+ * velocity estimator and the release velocity comes from its fit rather than from the last teleport.
+ */
+template<typename Policy>
+class TProjectileLauncher
+{
+public:
+	using FProjectileClass = typename Policy::FProjectileClass;
+
+	//Takes a parked projectile from the pool when there is one, the pool may be null
+	FProjectileClass* Spawn(UWorld* world, UGameplayActorPool* pool, int32 fingerIndex, const FVector& location, double time)
+	{
+		//A finger only holds one projectile, a new touch on it replaces one that was never thrown
+		if(FProjectileClass* stale = Find(fingerIndex))
+		{
+			if(pool) pool->Release(stale);
+			else stale->Destroy();
+		}
+		Remove(fingerIndex);
+
+		FProjectileClass* projectile = pool ? pool->Acquire<FProjectileClass>(FTransform(location)) : nullptr;
+		if(!projectile)
+		{
+			projectile = world->SpawnActor<FProjectileClass>(location, FRotator::ZeroRotator, FActorSpawnParameters());
+		}
+		if(projectile)
+		{
+			FHeldProjectile& entry = held.AddDefaulted_GetRef();
+			entry.fingerIndex = fingerIndex;
+			entry.projectile = projectile;
+			entry.velocityEstimator.AddSample(time, location);
+		}
+		return projectile;
+	}
+
+	bool Move(int32 fingerIndex, const FVector& location, double time)
+	{
+		FHeldProjectile* entry = FindEntry(fingerIndex);
+		FProjectileClass* projectile = entry ? entry->projectile.Get() : nullptr;
+		if(!projectile) return false;
+
+		projectile->SetActorLocation(location);
+		entry->velocityEstimator.AddSample(time, location);
+		return true;
+	}
+
+	//Releases the finger's projectile, applyVelocity decides whether the velocity is set now or on the next physics step
+	template<typename ApplyVelocityFunc>
+	bool Launch(int32 fingerIndex, double time, ApplyVelocityFunc&& applyVelocity)
+	{
+		FHeldProjectile* entry = FindEntry(fingerIndex);
+		FProjectileClass* projectile = entry ? entry->projectile.Get() : nullptr;
+		FVector releaseVelocity;
+		const bool estimated = entry && entry->velocityEstimator.Estimate(time, releaseVelocity);
+		Remove(fingerIndex);
+		if(!projectile) return false;
+
+		//Set the projectile physics to enabled
+		projectile->SetPhysicsSimulation(true);
+
+		//A tap with a single sample has nothing to fit, fall back to whatever the component reports
+		UStaticMeshComponent* meshComp = projectile->GetStaticMeshComponent();
+		if(!estimated) releaseVelocity = meshComp->GetComponentVelocity();
+		applyVelocity(meshComp, ProjectileLaunch::ClampLaunchVelocity(releaseVelocity));
+		projectile->SetPlayerProjectile(true); //Set this so player score increments
+		return true;
+	}
+
+	//Where the finger's projectile is, how big it is and the clamped velocity it would leave with if released at time
+	bool PreviewLaunch(int32 fingerIndex, double time, FVector& outLocation, FVector& outVelocity, float& outRadius)
+	{
+		FHeldProjectile* entry = FindEntry(fingerIndex);
+		FProjectileClass* projectile = entry ? entry->projectile.Get() : nullptr;
+		if(!projectile || !entry->velocityEstimator.Estimate(time, outVelocity)) return false;
+
+		outLocation = projectile->GetActorLocation();
+		outRadius = projectile->GetStaticMeshComponent()->Bounds.SphereRadius;
+		outVelocity = ProjectileLaunch::ClampLaunchVelocity(outVelocity);
+		return true;
+	}
+
+	int32 Num() const { return held.Num(); }
+
+private:
+	struct FHeldProjectile
+	{
+		int32 fingerIndex = INDEX_NONE;
+		TWeakObjectPtr<FProjectileClass> projectile;
+		FGestureVelocityEstimator velocityEstimator;
+	};
+
+	FHeldProjectile* FindEntry(int32 fingerIndex)
+	{
+		return held.FindByPredicate([fingerIndex](const FHeldProjectile& entry) { return entry.fingerIndex == fingerIndex; });
+	}
+
+	FProjectileClass* Find(int32 fingerIndex)
+	{
+		FHeldProjectile* entry = FindEntry(fingerIndex);
+		return entry ? entry->projectile.Get() : nullptr;
+	}
+
+	void Remove(int32 fingerIndex)
+	{
+		held.RemoveAllSwap([fingerIndex](const FHeldProjectile& entry) { return entry.fingerIndex == fingerIndex; });
+	}
+
+	//A handful of fingers at most, a linear search beats hashing
+	TArray<FHeldProjectile, TInlineAllocator<5>> held;
+};
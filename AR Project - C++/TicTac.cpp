@@ -4,6 +4,11 @@
 #include "TicTac.h"
 
 #include "Level0.h"
+#include "ARCollisionChannels.h"
+#include "ARGameplayAssets.h"
+#include "ARStats.h"
+#include "GameplayServicesSubsystem.h"
+#include "TicTacSignificanceManager.h"
 #include "Kismet/GameplayStatics.h"
 
 // Sets default values
@@ -21,11 +26,9 @@ ATicTac::ATicTac()
 	staticMeshComponent = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("StaticMeshComponent"));
 	staticMeshComponent->SetupAttachment(sceneComponent);
 	
-	//Settings
-	staticMeshComponent->SetCollisionProfileName("BlockAllDynamic");
-	staticMeshComponent->SetGenerateOverlapEvents(true);
-	staticMeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-	staticMeshComponent->SetNotifyRigidBodyCollision(true); //Stillllll a very important wee line
+	//Settings, no overlaps or hit notifies, landing on the platform is picked up by the platform's notify
+	ARCollision::ConfigureTurret(staticMeshComponent);
+	staticMeshComponent->SetNotifyRigidBodyCollision(false);
 	staticMeshComponent->SetSimulatePhysics(false);
 	staticMeshComponent->SetEnableGravity(false);
 	staticMeshComponent->SetWorldScale3D(scale);
@@ -34,21 +37,10 @@ ATicTac::ATicTac()
 	staticMeshComponent->BodyInstance.bLockYRotation = true;
 	staticMeshComponent->BodyInstance.bLockXRotation = true;
 	
-	auto MeshAsset = ConstructorHelpers::FObjectFinder<UStaticMesh>(TEXT("StaticMesh'/Engine/BasicShapes/Sphere.Sphere'"));
-	staticMeshComponent->SetStaticMesh(MeshAsset.Object);
-	
-	//Set the material
-	ConstructorHelpers::FObjectFinder<UMaterial>FoundMaterial(TEXT("Material'/Game/Assets/Materials/Andy_Mat_Default.Andy_Mat_Default'"));
-	
-	if(FoundMaterial.Succeeded())
-	{
-		ticTacMaterial = FoundMaterial.Object;
-	}
-	
-	ticTacMatInstance = UMaterialInstanceDynamic::Create(ticTacMaterial, staticMeshComponent);
-	staticMeshComponent->SetMaterial(0, ticTacMatInstance);
-
-	customGameMode = Cast<ACustomGameMode>(UGameplayStatics::GetGameMode(this));
+	//Shared mesh and material, nothing changes the material per tic tac so there is no instance to create
+	const FARGameplayAssets& assets = FARGameplayAssets::Get();
+	staticMeshComponent->SetStaticMesh(assets.sphereMesh);
+	staticMeshComponent->SetMaterial(0, assets.ticTacMaterial);
 }
 
 // Called when the game starts or when spawned
@@ -56,19 +48,43 @@ void ATicTac::BeginPlay()
 {
 	Super::BeginPlay();
 
-	//Get reference of the player
-	playerRef = customGameMode->GetPlayerReference();
+	//Get reference of the player once from the gameplay services
+	services = UGameplayServicesSubsystem::Get(this);
+	playerRef = services ? services->GetPlayer() : nullptr;
+
+	//Let the significance manager throttle this tic tac's tick, it only exists in game worlds
+	if(UTicTacSignificanceManager* significanceManager = GetWorld()->GetSubsystem<UTicTacSignificanceManager>())
+	{
+		significanceManager->RegisterTicTac(this);
+	}
+}
+
+void ATicTac::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if(UTicTacSignificanceManager* significanceManager = GetWorld()->GetSubsystem<UTicTacSignificanceManager>())
+	{
+		significanceManager->UnregisterTicTac(this);
+	}
+	
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
 void ATicTac::Tick(float DeltaTime)
 {
+	AR_SCOPED_STAT(TicTacTick);
 	Super::Tick(DeltaTime);
 	
 	FVector tictacLoc = staticMeshComponent->GetComponentLocation();
 
 	// GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, FString::Printf(TEXT("Tictac Location: %s"), *tictacLoc.ToString()));
 
+	//The player registers itself in its own BeginPlay, pick it up if it arrived after this tic tac
+	if(!playerRef && services)
+	{
+		playerRef = services->GetPlayer();
+	}
+
 	//Make sure the tic tacs always face the player
 	if(playerRef)
 	{
@@ -99,8 +115,8 @@ void ATicTac::Tick(float DeltaTime)
 		// 0.f // Time to persist (in seconds, use 0 to persist indefinitely)
 		// );
 
-		//Shoot the projectile at the player after reaching the delay
-		elapsedTime += GetWorld()->DeltaTimeSeconds;
+		//Shoot the projectile at the player after reaching the delay, DeltaTime covers the whole interval when throttled
+		elapsedTime += DeltaTime;
 		if(elapsedTime > delay)
 		{
 			elapsedTime = 0.f;
@@ -111,9 +127,15 @@ void ATicTac::Tick(float DeltaTime)
 	}
 }
 
+void ATicTac::RefreshLineOfSight()
+{
+	lastLineOfSight = HasLineOfSight();
+}
+
 void ATicTac::FireProjectile(FVector direction)
 {
-	if(!HasLineOfSight()) return;
+	lastLineOfSight = HasLineOfSight();
+	if(!lastLineOfSight) return;
 	//Fire a projectile at the player after a specific time
 	FVector loc = staticMeshComponent->GetComponentLocation();
 	FRotator rot = FRotator::ZeroRotator;
@@ -125,6 +147,8 @@ void ATicTac::FireProjectile(FVector direction)
 	projectile->SetPhysicsSimulation(true);
 	projectile->GetStaticMeshComponent()->SetEnableGravity(false);
 
+	ARCollision::ConfigureEnemyProjectile(projectile->GetStaticMeshComponent());
+
 	float force = 300.f;
 	projectile->GetStaticMeshComponent()->SetPhysicsLinearVelocity(direction * force);
 	staticMeshComponent->SetPhysicsLinearVelocity(FVector(0.f, 0.f, staticMeshComponent->GetComponentVelocity().Z));
@@ -132,6 +156,7 @@ void ATicTac::FireProjectile(FVector direction)
 
 bool ATicTac::HasLineOfSight()
 {
+	AR_SCOPED_STAT(HasLineOfSight);
 	if (!playerRef)
 		return false;
 
@@ -165,31 +190,39 @@ bool ATicTac::HasLineOfSight()
 	return false; // No line of sight to the player
 }
 
-void ATicTac::SetPhysicsSimulation(bool val)
+//Called by the significance manager, an interval of 0 ticks every frame
+void ATicTac::SetSignificanceTick(bool enabled, float interval)
 {
-	staticMeshComponent->SetSimulatePhysics(val);
-	staticMeshComponent->SetEnableGravity(val);
+	SetActorTickInterval(interval);
+	SetActorTickEnabled(enabled);
 }
 
-//Collision detection functions
-void ATicTac::NotifyHit(UPrimitiveComponent* comp, AActor* other, UPrimitiveComponent* otherComp, bool bSelfMoved,
-FVector hitLocation, FVector hitNormal, FVector normalImpulse, const FHitResult& hit)
+void ATicTac::SetParked(bool parked)
 {
-	//Deal with the collisions
-	Super::NotifyHit(comp, other, otherComp, bSelfMoved, hitLocation, hitNormal, normalImpulse, hit);
+	SetActorHiddenInGame(parked);
+	SetActorEnableCollision(!parked);
+	SetPhysicsSimulation(!parked);
 
-	//Check for if the actor is in the level class
-	if(other->IsA(ALevel0::StaticClass()))
+	//The significance manager would turn the tick back on, so a parked tic tac leaves it
+	UTicTacSignificanceManager* significanceManager = GetWorld()->GetSubsystem<UTicTacSignificanceManager>();
+	if(parked)
 	{
-		ALevel0* level = Cast<ALevel0>(other);
-		if(level)
-		{
-			UStaticMeshComponent* otherMeshComp = Cast<UStaticMeshComponent>(hit.Component.Get());
-
-			//If the tic tac is touching the platform then destroy it
-			if(!level->GetIsPlatform()) return;
-			//Call the collision response function
-			Destroy();
-		}
+		if(significanceManager) significanceManager->UnregisterTicTac(this);
+		SetActorTickEnabled(false);
+	}
+	else if(significanceManager)
+	{
+		significanceManager->RegisterTicTac(this);
 	}
-}
\ No newline at end of file
+	else
+	{
+		//Worlds without the manager tick every tic tac every frame
+		SetActorTickEnabled(true);
+	}
+}
+
+void ATicTac::SetPhysicsSimulation(bool val)
+{
+	staticMeshComponent->SetSimulatePhysics(val);
+	staticMeshComponent->SetEnableGravity(val);
+}
@@ -8,6 +8,8 @@
 #include "Projectile.h"
 #include "TicTac.generated.h"
 
+class UGameplayServicesSubsystem;
+
 UCLASS()
 class UE5_AR_API ATicTac : public AActor
 {
@@ -18,14 +20,19 @@ public:
 	ATicTac();
 	void SetPhysicsSimulation(bool val);
 	void FireProjectile(FVector direction);
+	void SetSignificanceTick(bool enabled, float interval);
+
+	//A parked tic tac belongs to a finished level, it is hidden, has no collision or physics and never ticks
+	void SetParked(bool parked);
+	bool GetLastLineOfSight() const { return lastLineOfSight; }
 
-	UFUNCTION()
-	virtual void NotifyHit(class UPrimitiveComponent* comp, AActor* other, UPrimitiveComponent* otherComp, bool bSelfMoved,
-	FVector hitLocation, FVector hitNormal, FVector normalImpulse, const FHitResult& hit) override;
+	//Lets the significance manager recheck a throttled or paused tic tac that last saw nothing
+	void RefreshLineOfSight();
 	
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	bool HasLineOfSight();
 	
 	UStaticMeshComponent* staticMeshComponent;
@@ -35,13 +42,12 @@ public:
 
 private:
 	USceneComponent* sceneComponent;
-	UMaterial* ticTacMaterial;
-	UMaterialInstanceDynamic* ticTacMatInstance;
 	FVector scale = FVector(0.2f,0.2,0.4f);
 
-	AThePlayer* playerRef;
-	ACustomGameMode* customGameMode;
+	AThePlayer* playerRef = nullptr;
+	UGameplayServicesSubsystem* services = nullptr;
 
 	float elapsedTime = 0.f;
+	bool lastLineOfSight = true; //Used by the significance manager, assume visible until the first shot says otherwise
 	float delay = FMath::RandRange(1, 4);
 };
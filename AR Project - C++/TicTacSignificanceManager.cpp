@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TicTacSignificanceManager.h"
+
+#include "Level0.h"
+#include "TicTac.h"
+#include "TowerBudgetManager.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+static TAutoConsoleVariable<int32> CVarTicTacFullRateCount(
+	TEXT("ar.TicTac.FullRateCount"), 16,
+	TEXT("Number of most significant tic tacs that tick every frame."));
+
+static TAutoConsoleVariable<int32> CVarTicTacMaxActive(
+	TEXT("ar.TicTac.MaxActive"), 128,
+	TEXT("Number of tic tacs allowed to tick at all, the rest are paused until they become significant."));
+
+static TAutoConsoleVariable<float> CVarTicTacReducedInterval(
+	TEXT("ar.TicTac.ReducedInterval"), 0.1f,
+	TEXT("Tick interval in seconds for tic tacs outside the full rate band, doubled for the back half of the band."));
+
+static TAutoConsoleVariable<int32> CVarTicTacSightRechecks(
+	TEXT("ar.TicTac.SightRechecksPerUpdate"), 8,
+	TEXT("Tic tacs without line of sight that get a fresh line trace per re-rank, so a throttled one is not penalised forever."));
+
+static TAutoConsoleVariable<float> CVarTicTacUpdateInterval(
+	TEXT("ar.TicTac.SignificanceUpdateInterval"), 0.25f,
+	TEXT("How often in seconds the tic tacs are re-ranked."));
+
+void UTicTacSignificanceManager::RegisterTicTac(ATicTac* ticTac)
+{
+	ticTacs.AddUnique(ticTac);
+	
+	//Force a re-rank so new tic tacs do not tick at full rate until the next update
+	timeSinceUpdate = TNumericLimits<float>::Max();
+}
+
+void UTicTacSignificanceManager::UnregisterTicTac(ATicTac* ticTac)
+{
+	ticTacs.RemoveSingleSwap(ticTac, false);
+}
+
+void UTicTacSignificanceManager::Tick(float DeltaTime)
+{
+	timeSinceUpdate += DeltaTime;
+	if(timeSinceUpdate < CVarTicTacUpdateInterval.GetValueOnGameThread()) return;
+	
+	timeSinceUpdate = 0.f;
+	UpdateSignificance();
+}
+
+void UTicTacSignificanceManager::UpdateSignificance()
+{
+	const APlayerController* playerController = GetWorld()->GetFirstPlayerController();
+	if(!playerController || !playerController->PlayerCameraManager) return;
+
+	const APlayerCameraManager* cameraManager = playerController->PlayerCameraManager;
+	const FVector cameraLocation = cameraManager->GetCameraLocation();
+	const FVector cameraForward = cameraManager->GetCameraRotation().Vector();
+	const float viewCosine = FMath::Cos(FMath::DegreesToRadians(cameraManager->GetFOVAngle() * 0.5f));
+
+	//With several towers up each turret is scaled by its tower's share, so the full rate band follows the tower budgets
+	const UTowerBudgetManager* towerBudgets = GetWorld()->GetSubsystem<UTowerBudgetManager>();
+	
+	//Only firing updates the line of sight, a paused or slow tic tac would keep a stale miss, so recheck a few in turn
+	int32 rechecks = FMath::Min(CVarTicTacSightRechecks.GetValueOnGameThread(), ticTacs.Num());
+	for(int32 visited = 0; visited < ticTacs.Num() && rechecks > 0; visited++)
+	{
+		sightRecheckCursor = (sightRecheckCursor + 1) % ticTacs.Num();
+		ATicTac* ticTac = ticTacs[sightRecheckCursor];
+		if(IsValid(ticTac) && !ticTac->GetLastLineOfSight())
+		{
+			ticTac->RefreshLineOfSight();
+			rechecks--;
+		}
+	}
+	
+	ranked.Reset(ticTacs.Num());
+	for(ATicTac* ticTac : ticTacs)
+	{
+		if(IsValid(ticTac))
+		{
+			float significance = CalculateSignificance(ticTac, cameraLocation, cameraForward, viewCosine);
+			if(towerBudgets && towerBudgets->GetNumTowers() > 1)
+			{
+				significance *= towerBudgets->GetTowerWeight(Cast<ALevel0>(ticTac->GetOwner()));
+			}
+			ranked.Add({ ticTac, significance });
+		}
+	}
+	ranked.Sort([](const FRankedTicTac& a, const FRankedTicTac& b) { return a.significance > b.significance; });
+
+	const int32 fullRateCount = CVarTicTacFullRateCount.GetValueOnGameThread();
+	const int32 maxActive = FMath::Max(CVarTicTacMaxActive.GetValueOnGameThread(), fullRateCount);
+	const float reducedInterval = CVarTicTacReducedInterval.GetValueOnGameThread();
+	const int32 reducedHalf = fullRateCount + (maxActive - fullRateCount) / 2;
+
+	numFullRate = 0;
+	numReduced = 0;
+	numPaused = 0;
+	
+	for(int32 rank = 0; rank < ranked.Num(); rank++)
+	{
+		ATicTac* ticTac = ranked[rank].ticTac;
+		if(rank < fullRateCount)
+		{
+			ticTac->SetSignificanceTick(true, 0.f);
+			numFullRate++;
+		}
+		else if(rank < maxActive)
+		{
+			ticTac->SetSignificanceTick(true, rank < reducedHalf ? reducedInterval : reducedInterval * 2.f);
+			numReduced++;
+		}
+		else
+		{
+			ticTac->SetSignificanceTick(false, 0.f);
+			numPaused++;
+		}
+	}
+}
+
+float UTicTacSignificanceManager::CalculateSignificance(const ATicTac* ticTac, const FVector& cameraLocation, const FVector& cameraForward, float viewCosine) const
+{
+	const FVector toTicTac = ticTac->GetActorLocation() - cameraLocation;
+	const float distance = toTicTac.Size();
+
+	//Closer is more significant, halved when out of view and again when it could not see the player last time it tried
+	float significance = 1.f / (1.f + distance * 0.01f);
+	if(distance > KINDA_SMALL_NUMBER && FVector::DotProduct(toTicTac / distance, cameraForward) < viewCosine)
+	{
+		significance *= 0.5f;
+	}
+	if(!ticTac->GetLastLineOfSight())
+	{
+		significance *= 0.5f;
+	}
+	return significance;
+}
+
+TStatId UTicTacSignificanceManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTicTacSignificanceManager, STATGROUP_Tickables);
+}
+
+bool UTicTacSignificanceManager::DoesSupportWorldType(const EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
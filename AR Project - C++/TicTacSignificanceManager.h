@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TicTacSignificanceManager.generated.h"
+
+class ATicTac;
+
+/**
+ * Ranks the tic tacs by distance to the AR camera, whether they are in view and whether they last had
+ * line of sight, then throttles their ticking. The most significant keep full rate, the next bands tick
+ * at reduced intervals and anything past ar.TicTac.MaxActive is paused until it becomes significant again.
+ */
+UCLASS()
+class UE5_AR_API UTicTacSignificanceManager : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterTicTac(ATicTac* ticTac);
+	void UnregisterTicTac(ATicTac* ticTac);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	int32 GetNumRegistered() const { return ticTacs.Num(); }
+	int32 GetNumFullRate() const { return numFullRate; }
+	int32 GetNumReduced() const { return numReduced; }
+	int32 GetNumPaused() const { return numPaused; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type worldType) const override;
+
+private:
+	struct FRankedTicTac
+	{
+		ATicTac* ticTac;
+		float significance;
+	};
+
+	void UpdateSignificance();
+	float CalculateSignificance(const ATicTac* ticTac, const FVector& cameraLocation, const FVector& cameraForward, float viewCosine) const;
+	
+	UPROPERTY()
+	TArray<ATicTac*> ticTacs;
+	
+	TArray<FRankedTicTac> ranked;
+	float timeSinceUpdate = 0.f;
+	int32 numFullRate = 0;
+	int32 numReduced = 0;
+	int32 numPaused = 0;
+	int32 sightRecheckCursor = 0;
+};
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TouchTimestampProcessor.h"
+
+#include "Input/Events.h"
+
+bool FTouchTimestampProcessor::PopTimestamp(int32 fingerIndex, double& outTime)
+{
+	auto* fingerStamps = timestamps.Find(fingerIndex);
+	if(!fingerStamps || fingerStamps->Num() == 0) return false;
+
+	outTime = (*fingerStamps)[0];
+	fingerStamps->RemoveAt(0, 1, false);
+	return true;
+}
+
+void FTouchTimestampProcessor::ResetFinger(int32 fingerIndex)
+{
+	if(auto* fingerStamps = timestamps.Find(fingerIndex))
+	{
+		fingerStamps->Reset();
+	}
+}
+
+//Only looks at the events, they are never consumed
+bool FTouchTimestampProcessor::HandleMouseButtonDownEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent)
+{
+	if(MouseEvent.IsTouchEvent())
+	{
+		ResetFinger(MouseEvent.GetPointerIndex());
+		Stamp(MouseEvent);
+	}
+	return false;
+}
+
+bool FTouchTimestampProcessor::HandleMouseButtonUpEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent)
+{
+	if(MouseEvent.IsTouchEvent()) Stamp(MouseEvent);
+	return false;
+}
+
+bool FTouchTimestampProcessor::HandleMouseMoveEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent)
+{
+	if(MouseEvent.IsTouchEvent()) Stamp(MouseEvent);
+	return false;
+}
+
+//Touches nothing picks up, e.g. taps that place a level, are capped so the queue cannot grow without bound
+void FTouchTimestampProcessor::Stamp(const FPointerEvent& event)
+{
+	auto& fingerStamps = timestamps.FindOrAdd(event.GetPointerIndex());
+	if(fingerStamps.Num() >= maxQueued) fingerStamps.RemoveAt(0, 1, false);
+	fingerStamps.Add(FPlatformTime::Seconds());
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Framework/Application/IInputProcessor.h"
+
+/**
+ * Stamps every touch event with the time Slate received it, before the player's touch bindings run later in the
+ * frame. Several events of one finger can arrive in a single frame, so the stamps are queued per finger and taken
+ * in order by the gesture samples they belong to. A new press clears whatever its finger left behind.
+ */
+class UE5_AR_API FTouchTimestampProcessor : public IInputProcessor
+{
+public:
+	static constexpr int32 maxQueued = 32;
+
+	//False when the finger has no stamp waiting, e.g. a sample that did not come from a Slate touch event
+	bool PopTimestamp(int32 fingerIndex, double& outTime);
+	void ResetFinger(int32 fingerIndex);
+
+	virtual void Tick(const float DeltaTime, FSlateApplication& SlateApp, TSharedRef<ICursor> Cursor) override {}
+	virtual bool HandleMouseButtonDownEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent) override;
+	virtual bool HandleMouseButtonUpEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent) override;
+	virtual bool HandleMouseMoveEvent(FSlateApplication& SlateApp, const FPointerEvent& MouseEvent) override;
+	virtual const TCHAR* GetDebugName() const override { return TEXT("ARTouchTimestamps"); }
+
+private:
+	void Stamp(const FPointerEvent& event);
+
+	TMap<int32, TArray<double, TInlineAllocator<8>>> timestamps;
+};
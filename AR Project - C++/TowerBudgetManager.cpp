@@ -0,0 +1,144 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TowerBudgetManager.h"
+
+#include "ARStats.h"
+#include "Level0.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+static TAutoConsoleVariable<int32> CVarTowerActivationBudget(
+	TEXT("ar.Tower.ActivationBudget"), 48,
+	TEXT("Blocks woken from kinematic to simulating per frame across all towers, 0 removes the limit."));
+
+static TAutoConsoleVariable<int32> CVarTowerRemovalBudget(
+	TEXT("ar.Tower.RemovalBudget"), 32,
+	TEXT("Fallen blocks removed per frame across all towers, 0 removes the limit."));
+
+void UTowerBudgetManager::RegisterTower(ALevel0* tower)
+{
+	towers.AddUnique(tower);
+}
+
+void UTowerBudgetManager::UnregisterTower(ALevel0* tower)
+{
+	towers.RemoveSingleSwap(tower, false);
+	budgets.RemoveAllSwap([tower](const FTowerBudget& budget) { return budget.tower == tower; }, false);
+}
+
+void UTowerBudgetManager::Tick(float DeltaTime)
+{
+	const APlayerController* playerController = GetWorld()->GetFirstPlayerController();
+	const APlayerCameraManager* cameraManager = playerController ? playerController->PlayerCameraManager : nullptr;
+	const FVector cameraLocation = cameraManager ? cameraManager->GetCameraLocation() : FVector::ZeroVector;
+	const FVector cameraForward = cameraManager ? cameraManager->GetCameraRotation().Vector() : FVector::ForwardVector;
+	const float viewCosine = cameraManager ? FMath::Cos(FMath::DegreesToRadians(cameraManager->GetFOVAngle() * 0.5f)) : -1.f;
+
+	//Same shape as the tic tac significance, closer and in view matter more, a collapsing tower more still
+	budgets.Reset(towers.Num());
+	float totalSignificance = 0.f;
+	for(ALevel0* tower : towers)
+	{
+		if(!IsValid(tower) || tower->IsHidden()) continue;
+
+		const FVector toTower = tower->GetActorLocation() - cameraLocation;
+		const float distance = toTower.Size();
+		float significance = 1.f / (1.f + distance * 0.01f);
+		if(distance > KINDA_SMALL_NUMBER && FVector::DotProduct(toTower / distance, cameraForward) < viewCosine)
+		{
+			significance *= 0.5f;
+		}
+		if(tower->GetPendingWork() > 0)
+		{
+			significance *= 2.f;
+		}
+
+		FTowerBudget& budget = budgets.AddDefaulted_GetRef();
+		budget.tower = tower;
+		budget.weight = significance;
+		totalSignificance += significance;
+	}
+
+	for(FTowerBudget& budget : budgets)
+	{
+		budget.weight = totalSignificance > 0.f ? budget.weight / totalSignificance : 1.f;
+	}
+	SplitBudget(CVarTowerActivationBudget.GetValueOnGameThread(), false);
+	SplitBudget(CVarTowerRemovalBudget.GetValueOnGameThread(), true);
+	remainderCursor = budgets.Num() > 0 ? (remainderCursor + 1) % budgets.Num() : 0;
+	SET_DWORD_STAT(STAT_AR_Towers, budgets.Num());
+}
+
+//Only towers with work waiting get a share, split by their weights. Rounding down leaves less than one block per
+//tower, handed out in turn to the same towers
+void UTowerBudgetManager::SplitBudget(int32 budget, bool removal)
+{
+	float busyWeight = 0.f;
+	for(const FTowerBudget& entry : budgets)
+	{
+		if(entry.tower->GetPendingWork() > 0) busyWeight += entry.weight;
+	}
+
+	int32 remaining = budget;
+	for(FTowerBudget& entry : budgets)
+	{
+		int32& share = removal ? entry.removalBudget : entry.activationBudget;
+		if(budget <= 0)
+		{
+			share = MAX_int32;
+			continue;
+		}
+
+		const bool busy = busyWeight > 0.f && entry.tower->GetPendingWork() > 0;
+		share = busy ? FMath::Min(FMath::FloorToInt(budget * entry.weight / busyWeight), remaining) : 0;
+		remaining -= share;
+	}
+	if(budget <= 0) return;
+
+	for(int32 step = 0; step < budgets.Num() && remaining > 0; step++)
+	{
+		FTowerBudget& entry = budgets[(remainderCursor + step) % budgets.Num()];
+		if(entry.tower->GetPendingWork() > 0)
+		{
+			(removal ? entry.removalBudget : entry.activationBudget)++;
+			remaining--;
+		}
+	}
+}
+
+const UTowerBudgetManager::FTowerBudget* UTowerBudgetManager::Find(const ALevel0* tower) const
+{
+	return budgets.FindByPredicate([tower](const FTowerBudget& budget) { return budget.tower == tower; });
+}
+
+int32 UTowerBudgetManager::GetActivationBudget(const ALevel0* tower) const
+{
+	const FTowerBudget* budget = Find(tower);
+	if(budget) return budget->activationBudget;
+	return towers.Contains(tower) ? 0 : MAX_int32;
+}
+
+int32 UTowerBudgetManager::GetRemovalBudget(const ALevel0* tower) const
+{
+	const FTowerBudget* budget = Find(tower);
+	if(budget) return budget->removalBudget;
+	return towers.Contains(tower) ? 0 : MAX_int32;
+}
+
+float UTowerBudgetManager::GetTowerWeight(const ALevel0* tower) const
+{
+	const FTowerBudget* budget = Find(tower);
+	return budget ? budget->weight : 1.f;
+}
+
+TStatId UTowerBudgetManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTowerBudgetManager, STATGROUP_Tickables);
+}
+
+bool UTowerBudgetManager::DoesSupportWorldType(const EWorldType::Type worldType) const
+{
+	return worldType == EWorldType::Game || worldType == EWorldType::PIE;
+}
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TowerBudgetManager.generated.h"
+
+class ALevel0;
+
+/**
+ * Shares the per-frame destruction work between every tower in play. Each frame the towers are weighted by
+ * distance to the AR camera, whether they are in view and how much queued work they have, and the global
+ * budgets for waking blocks (ar.Tower.ActivationBudget) and removing fallen blocks (ar.Tower.RemovalBudget)
+ * are split by weight between the towers with queued work, idle towers get none. What rounding leaves over goes
+ * one at a time to the same towers, starting from a different tower each frame, so the shares never add up to
+ * more than the budget and nothing starves.
+ * The tic tac significance manager scales each turret by its tower's weight, so turret ticking follows the
+ * same split.
+ */
+UCLASS()
+class UE5_AR_API UTowerBudgetManager : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterTower(ALevel0* tower);
+	void UnregisterTower(ALevel0* tower);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	//Budgets for this frame, none for a tower registered since the last split and unlimited for a tower the
+	//manager does not know about
+	int32 GetActivationBudget(const ALevel0* tower) const;
+	int32 GetRemovalBudget(const ALevel0* tower) const;
+
+	//Share of the total significance, 1 with a single tower
+	float GetTowerWeight(const ALevel0* tower) const;
+
+	//Towers in play this frame, parked towers are registered but not counted
+	int32 GetNumTowers() const { return budgets.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type worldType) const override;
+
+private:
+	struct FTowerBudget
+	{
+		ALevel0* tower = nullptr;
+		float weight = 1.f;
+		int32 activationBudget = MAX_int32;
+		int32 removalBudget = MAX_int32;
+	};
+
+	const FTowerBudget* Find(const ALevel0* tower) const;
+	void SplitBudget(int32 budget, bool removal);
+
+	UPROPERTY()
+	TArray<ALevel0*> towers;
+
+	TArray<FTowerBudget> budgets;
+	int32 remainderCursor = 0;
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "UIManager.h"
+
+#include "WidgetBase.h"
+
+void UUIManager::BuildScreen(UWorld* world, EGameScreen screen, TSubclassOf<UWidgetBase> widgetClass)
+{
+	screens.SetNumZeroed(static_cast<int32>(EGameScreen::Count));
+	if(!world || !widgetClass) return;
+
+	//Create the widget and add it collapsed, showing it later is only a visibility change
+	UWidgetBase* widget = CreateWidget<UWidgetBase>(world, widgetClass);
+	if(!widget) return;
+	
+	widget->AddToViewport();
+	widget->SetVisibility(ESlateVisibility::Collapsed);
+	screens[static_cast<int32>(screen)] = widget;
+}
+
+void UUIManager::ShowScreen(EGameScreen screen)
+{
+	UWidgetBase* widget = GetScreen(screen);
+	if(!widget) return;
+
+	//Blueprints may have removed the screen from the parent, the cached widget is still valid to reuse
+	if(!widget->IsInViewport())
+	{
+		widget->AddToViewport();
+	}
+	widget->SetVisibility(ESlateVisibility::Visible);
+}
+
+void UUIManager::HideScreen(EGameScreen screen)
+{
+	if(UWidgetBase* widget = GetScreen(screen))
+	{
+		widget->SetVisibility(ESlateVisibility::Collapsed);
+	}
+}
+
+void UUIManager::HideAllScreens()
+{
+	for(UWidgetBase* widget : screens)
+	{
+		if(widget) widget->SetVisibility(ESlateVisibility::Collapsed);
+	}
+}
+
+void UUIManager::PrewarmScreens()
+{
+	for(UWidgetBase* widget : screens)
+	{
+		if(widget) widget->ForceLayoutPrepass();
+	}
+}
+
+bool UUIManager::IsScreenVisible(EGameScreen screen) const
+{
+	const UWidgetBase* widget = GetScreen(screen);
+	return widget && widget->IsInViewport() && widget->GetVisibility() != ESlateVisibility::Collapsed;
+}
+
+UWidgetBase* UUIManager::GetScreen(EGameScreen screen) const
+{
+	const int32 index = static_cast<int32>(screen);
+	return screens.IsValidIndex(index) ? screens[index] : nullptr;
+}
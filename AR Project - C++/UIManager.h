@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "UIManager.generated.h"
+
+class UWidgetBase;
+
+UENUM(BlueprintType)
+enum class EGameScreen : uint8
+{
+	Win,
+	Count UMETA(Hidden)
+};
+
+/**
+ * Builds the game's screens once while loading and then only toggles their visibility,
+ * so showing a screen mid game never constructs a Slate hierarchy.
+ */
+UCLASS(BlueprintType)
+class UE5_AR_API UUIManager : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	void BuildScreen(UWorld* world, EGameScreen screen, TSubclassOf<UWidgetBase> widgetClass);
+
+	//Callable from the widgets, e.g. the win screen hiding itself when the player returns to level select
+	UFUNCTION(BlueprintCallable, Category = "UI")
+	void ShowScreen(EGameScreen screen);
+
+	UFUNCTION(BlueprintCallable, Category = "UI")
+	void HideScreen(EGameScreen screen);
+
+	UFUNCTION(BlueprintCallable, Category = "UI")
+	void HideAllScreens();
+
+	//Runs the Slate layout of every built screen once so the first show does not pay for it
+	void PrewarmScreens();
+	
+	UFUNCTION(BlueprintCallable, Category = "UI")
+	bool IsScreenVisible(EGameScreen screen) const;
+
+	UFUNCTION(BlueprintCallable, Category = "UI")
+	UWidgetBase* GetScreen(EGameScreen screen) const;
+
+private:
+	//Indexed by EGameScreen
+	UPROPERTY()
+	TArray<UWidgetBase*> screens;
+};
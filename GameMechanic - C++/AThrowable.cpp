@@ -2,6 +2,8 @@
 
 
 #include "AThrowable.h"
+#include "GameMechanicCollision.h"
+#include "GameMechanicStats.h"
 
 // Sets default values
 AAThrowable::AAThrowable()
@@ -11,16 +13,13 @@ AAThrowable::AAThrowable()
 
 	//Initialise the throwable object
 	mesh_comp = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Ice Ball"));
-	mesh_comp->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
 	mesh_comp->SetupAttachment(RootComponent);
 	static ConstructorHelpers::FObjectFinder<UStaticMesh>mesh_s(TEXT("/Game/StarterContent/Shapes/Shape_Sphere.Shape_Sphere"));
 	if (mesh_s.Succeeded())
 	{
+		GameMechanicCollision::ConfigurePlayerProjectile(mesh_comp);
 		mesh_comp->SetNotifyRigidBodyCollision(true);
-		mesh_comp->SetGenerateOverlapEvents(true);
 		mesh_comp->SetEnableGravity(false);
-		mesh_comp->SetCollisionProfileName(FName("BlockAllDynamic"));
-		mesh_comp->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		mesh_comp->SetStaticMesh(mesh_s.Object);
 		mesh_comp->SetRelativeLocation(FVector(0.f, 0.f, 0.f));
 		mesh_comp->SetWorldScale3D(FVector(0.5f));
@@ -78,6 +77,7 @@ void AAThrowable::Tick(float DeltaTime)
 void AAThrowable::OnHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, 
 	FVector NormalImpulse, const FHitResult& Hit)
 {
+	GM_COUNT_EVENT(HitEvents);
 	//Delay before destroying object so user can see the explosion
 	FTimerHandle t;
 	float duration = 0.5f;
@@ -2,6 +2,7 @@
 
 
 #include "Dummy.h"
+#include "GameMechanicCollision.h"
 
 // Sets default values
 ADummy::ADummy()
@@ -11,18 +12,17 @@ ADummy::ADummy()
 
 	//Initialise the enemy dummies here
 	mesh_comp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Dummy"));
-	mesh_comp->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
 	mesh_comp->SetupAttachment(RootComponent);
 	static ConstructorHelpers::FObjectFinder<USkeletalMesh>mesh_s(TEXT("/Game/Characters/Mannequins/Meshes/SKM_Quinn.SKM_Quinn"));
 
 	if (mesh_s.Succeeded())
 	{
 		mesh_comp->SetSkeletalMesh(mesh_s.Object);
-		mesh_comp->SetNotifyRigidBodyCollision(true);
-		mesh_comp->SetGenerateOverlapEvents(true);
+		//The dummy blocks throwables but its hit handler does nothing, so it does not ask for hit events
+		GameMechanicCollision::ConfigureEnemyBody(mesh_comp);
+		mesh_comp->SetCollisionResponseToChannel(GameMechanicCollision::PlayerProjectile, ECR_Block);
+		mesh_comp->SetNotifyRigidBodyCollision(false);
 		mesh_comp->SetEnableGravity(true);
-		mesh_comp->SetCollisionProfileName(FName("BlockAllDynamic"));
-		mesh_comp->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		mesh_comp->SetMassScale(FName("Mass"), 100.f);
 		FRotator rotation(0.f, 90.f, 0.f);
 		mesh_comp->SetRelativeRotation(rotation);
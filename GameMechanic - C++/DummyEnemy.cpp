@@ -1,6 +1,8 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "DummyEnemy.h"
+#include "GameMechanicCollision.h"
+#include "GameMechanicStats.h"
 
 // Sets default values
 ADummyEnemy::ADummyEnemy()
@@ -13,18 +15,16 @@ ADummyEnemy::ADummyEnemy()
 
 	//Initialise the enemy dummies here
 	mesh_comp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Dummy"));
-	mesh_comp->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
 	mesh_comp->SetupAttachment(RootComponent);
 	static ConstructorHelpers::FObjectFinder<USkeletalMesh>mesh_s(TEXT("/Game/Characters/Mannequins/Meshes/SKM_Quinn.SKM_Quinn"));
 
 	if (mesh_s.Succeeded())
 	{
 		mesh_comp->SetSkeletalMesh(mesh_s.Object);
-		mesh_comp->SetNotifyRigidBodyCollision(true);
-		mesh_comp->SetGenerateOverlapEvents(true);
+		//The hit box takes the throwables, the body only blocks the world and pawns
+		GameMechanicCollision::ConfigureEnemyBody(mesh_comp);
+		mesh_comp->SetNotifyRigidBodyCollision(false);
 		mesh_comp->SetEnableGravity(true);
-		mesh_comp->SetCollisionProfileName(FName("Pawn"));
-		mesh_comp->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		mesh_comp->SetMassScale(FName("Mass"), 100.f);
 		FRotator rotation(0.f, 90.f, 0.f);
 		mesh_comp->SetRelativeLocation(FVector(0.f, 0.f, -90.f));
@@ -37,17 +37,14 @@ ADummyEnemy::ADummyEnemy()
 
 	//Initialise the hit which will be invisible in scene
 	hit_box = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Hit Box"));
-	hit_box->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Overlap);
 	hit_box->SetupAttachment(RootComponent);
 	static ConstructorHelpers::FObjectFinder<UStaticMesh>hit_mesh(TEXT("/Game/StarterContent/Shapes/Shape_Cube.Shape_Cube"));
 	if (hit_mesh.Succeeded())
 	{
 		hit_box->SetStaticMesh(hit_mesh.Object);
+		GameMechanicCollision::ConfigureEnemyHitBox(hit_box);
 		hit_box->SetNotifyRigidBodyCollision(true);
-		hit_box->SetGenerateOverlapEvents(true);
 		hit_box->SetEnableGravity(false);
-		hit_box->SetCollisionProfileName(FName("BlockAllDynamic"));
-		hit_box->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		hit_box->SetRelativeLocation(FVector(0.f, 0.f, -90.f));
 		hit_box->SetWorldScale3D(FVector(0.3f, 0.35f, 1.6f));
 		hit_box->SetMassScale(FName("Mass"), 3.f);
@@ -97,6 +94,7 @@ void ADummyEnemy::SetupPlayerInputComponent(UInputComponent* PlayerInputComponen
 void ADummyEnemy::OnHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp,
 	FVector NormalImpulse, const FHitResult& Hit)
 {
+	GM_COUNT_EVENT(HitEvents);
 	//Delay before destroying object so user can see the explosion
 	if (health > 0)
 	{
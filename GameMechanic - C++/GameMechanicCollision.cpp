@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameMechanicCollision.h"
+
+#include "Components/PrimitiveComponent.h"
+
+namespace GameMechanicCollision
+{
+	static void ConfigureObject(UPrimitiveComponent* component, ECollisionChannel objectType)
+	{
+		component->SetCollisionObjectType(objectType);
+		component->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		component->SetCollisionResponseToAllChannels(ECR_Ignore);
+		component->SetGenerateOverlapEvents(false);
+	}
+
+	void ConfigurePlayerProjectile(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, PlayerProjectile);
+		component->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_WorldDynamic, ECR_Block);
+		component->SetCollisionResponseToChannel(Enemy, ECR_Block);
+	}
+
+	void ConfigureEnemyBody(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, Enemy);
+		component->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_WorldDynamic, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Pawn, ECR_Block);
+		component->SetCollisionResponseToChannel(ECC_Visibility, ECR_Block);
+	}
+
+	void ConfigureEnemyHitBox(UPrimitiveComponent* component)
+	{
+		ConfigureObject(component, Enemy);
+		component->SetCollisionResponseToChannel(PlayerProjectile, ECR_Block);
+	}
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+
+class UPrimitiveComponent;
+
+/*
+ * Object channels for the throwables and the dummies and the response matrix between them. The channels are
+ * named in the project's collision settings (Config/DefaultEngine.ini), the values must match the order they
+ * were added there.
+ *
+ *                     PlayerProjectile  Enemy  Pawn  World
+ *   PlayerProjectile  -                 B      -     B
+ *   Enemy (hit box)   B                 -      -     -
+ *   Enemy (body)      -                 -      B     B
+ *
+ * Nothing handles overlaps so overlap events are off. Only the throwable and the enemy hit box notify hits,
+ * the bodies that merely block do not.
+ */
+namespace GameMechanicCollision
+{
+	//Throwables launched by the player
+	constexpr ECollisionChannel PlayerProjectile = ECC_GameTraceChannel1;
+
+	//Dummies and enemies
+	constexpr ECollisionChannel Enemy = ECC_GameTraceChannel2;
+
+	GAMEMECHANICFINAL_API void ConfigurePlayerProjectile(UPrimitiveComponent* component);
+
+	//The enemy's visible body, blocks the world and pawns but lets throwables through to the hit box
+	GAMEMECHANICFINAL_API void ConfigureEnemyBody(UPrimitiveComponent* component);
+
+	//Only reacts to throwables, so walking into an enemy no longer counts as a hit
+	GAMEMECHANICFINAL_API void ConfigureEnemyHitBox(UPrimitiveComponent* component);
+}
@@ -7,6 +7,7 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "GameMechanicStats.h"
 
 //////////////////////////////////////////////////////////////////////////
 // AGameMechanicFinalCharacter
@@ -86,6 +87,7 @@ void AGameMechanicFinalCharacter::SetupPlayerInputComponent(class UInputComponen
 
 void AGameMechanicFinalCharacter::Tick(float DeltaTime)
 {
+	GM_SCOPED_STAT(CharacterTick);
 	FTimerHandle t;
 	float duration = 1.f;
 	//Use the timer to increase the player health to maximum (cool down period)
@@ -0,0 +1,10 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameMechanicStats.h"
+
+DEFINE_STAT(STAT_GM_CharacterTick);
+DEFINE_STAT(STAT_GM_HitEvents);
+
+CSV_DEFINE_CATEGORY_MODULE(GAMEMECHANICFINAL_API, GameMechanic, true);
+UE_TRACE_CHANNEL_DEFINE(GameMechanicChannel);
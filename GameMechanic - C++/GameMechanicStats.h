@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+//Character tick timing and dummy hit counts, shown with "stat GameMechanic" and in csvprofile captures
+
+DECLARE_STATS_GROUP(TEXT("GameMechanic"), STATGROUP_GameMechanic, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Tick"), STAT_GM_CharacterTick, STATGROUP_GameMechanic, GAMEMECHANICFINAL_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hit Events"), STAT_GM_HitEvents, STATGROUP_GameMechanic, GAMEMECHANICFINAL_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(GAMEMECHANICFINAL_API, GameMechanic);
+UE_TRACE_CHANNEL_EXTERN(GameMechanicChannel, GAMEMECHANICFINAL_API);
+
+#if UE_BUILD_SHIPPING
+#define GM_SCOPED_STAT(Name) \
+	CSV_SCOPED_TIMING_STAT(GameMechanic, Name)
+#else
+#define GM_SCOPED_STAT(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_GM_##Name); \
+	CSV_SCOPED_TIMING_STAT(GameMechanic, Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, GameMechanicChannel)
+#endif
+
+//Counts a gameplay event into the stat counter and the per-frame CSV column, events per second is the
+//CSV column summed over a second of frames
+#if UE_BUILD_SHIPPING
+#define GM_COUNT_EVENT(Name) \
+	CSV_CUSTOM_STAT(GameMechanic, Name, 1, ECsvCustomStatOp::Accumulate)
+#else
+#define GM_COUNT_EVENT(Name) \
+	INC_DWORD_STAT(STAT_GM_##Name); \
+	CSV_CUSTOM_STAT(GameMechanic, Name, 1, ECsvCustomStatOp::Accumulate)
+#endif